@@ -1,54 +1,286 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <dirent.h>
-#include <sys/time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #define MAX_PATH 1024
-#define MAX_COMMAND 2048
+#define MAX_WORKERS 1024
+
+#define STATUS_SAT 0
+#define STATUS_UNSAT 1
+#define STATUS_TIMEOUT 2
+#define STATUS_MEMOUT 3
+#define STATUS_ERROR 4
 
-// Function to run the solver on a given file and measure execution time
-double run_solver(const char *solver_path, const char *cnf_file) {
-    struct timeval start, end;
-    double elapsed_time;
-    pid_t pid;
+static const char* status_names[] = {"SAT", "UNSAT", "TIMEOUT", "MEMOUT", "ERROR"};
+
+// Limits and parallelism, set from the command line
+typedef struct {
+    int workers;
+    double wall_limit; // seconds, 0 for none
+    double cpu_limit;  // seconds, 0 for none
+    long memory_limit; // MB, 0 for none
+    bool pin;          // pin worker i to CPU i
+} RunOptions;
+
+// Outcome of one instance
+typedef struct {
     int status;
-    
-    gettimeofday(&start, NULL);
-    
-    // Fork a process to run the solver
-    pid = fork();
-    
+    double wall_time;
+    double cpu_time;
+    bool done;
+} RunResult;
+
+// A running solver process
+typedef struct {
+    pid_t pid;    // 0 if the worker is idle
+    int instance; // index into the sorted file list
+    int output;   // temporary file receiving the solver's stdout and stderr
+    struct timespec start;
+    bool killed;  // wall time limit reached
+} Worker;
+
+static double elapsed_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Child side: apply the limits and run the solver with its output in worker->output
+static void exec_solver(const char* solver_path, const char* cnf_file, int slot, int output, RunOptions* options) {
+    if (options->cpu_limit > 0) {
+        // SIGXCPU at the soft limit, SIGKILL one second later
+        struct rlimit cpu;
+        cpu.rlim_cur = (rlim_t)(options->cpu_limit + 0.999);
+        cpu.rlim_max = cpu.rlim_cur + 1;
+        setrlimit(RLIMIT_CPU, &cpu);
+    }
+    if (options->memory_limit > 0) {
+        struct rlimit memory;
+        memory.rlim_cur = memory.rlim_max = (rlim_t)options->memory_limit * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &memory);
+    }
+    if (options->pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(slot % sysconf(_SC_NPROCESSORS_ONLN), &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+    dup2(output, STDOUT_FILENO);
+    dup2(output, STDERR_FILENO);
+    execl(solver_path, solver_path, cnf_file, (char*)NULL);
+
+    // If execl returns, there was an error
+    perror("Execution failed");
+    _exit(EXIT_FAILURE);
+}
+
+// Start the solver on an instance in an idle worker
+static bool start_worker(Worker* worker, int slot, const char* solver_path, const char* cnf_file, int instance, RunOptions* options) {
+    ftruncate(worker->output, 0);
+    lseek(worker->output, 0, SEEK_SET);
+    clock_gettime(CLOCK_MONOTONIC, &worker->start);
+
+    pid_t pid = fork();
     if (pid == -1) {
         perror("Fork failed");
+        return false;
+    }
+    if (pid == 0) {
+        exec_solver(solver_path, cnf_file, slot, worker->output, options);
+    }
+    worker->pid = pid;
+    worker->instance = instance;
+    worker->killed = false;
+    return true;
+}
+
+// Classify a finished solver run from its exit status and its output
+static int classify_run(Worker* worker, int status) {
+    if (worker->killed) {
+        return STATUS_TIMEOUT;
+    }
+    if (WIFSIGNALED(status)) {
+        // RLIMIT_CPU: SIGXCPU first, SIGKILL at the hard limit
+        int sig = WTERMSIG(status);
+        return (sig == SIGXCPU || sig == SIGKILL) ? STATUS_TIMEOUT : STATUS_ERROR;
+    }
+
+    char buffer[4096];
+    lseek(worker->output, 0, SEEK_SET);
+    ssize_t n = read(worker->output, buffer, sizeof(buffer) - 1);
+    buffer[n > 0 ? n : 0] = '\0';
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        if (strstr(buffer, "RESULT: SAT")) {
+            return STATUS_SAT;
+        }
+        if (strstr(buffer, "RESULT: UNSAT")) {
+            return STATUS_UNSAT;
+        }
+    }
+    // the solver reports failed allocations with perror("Failed to allocate ...")
+    if (strstr(buffer, "Failed to") && strstr(buffer, "memory")) {
+        return STATUS_MEMOUT;
+    }
+    return STATUS_ERROR;
+}
+
+// Seconds until the earliest wall time deadline of the running workers, -1 if none
+static double next_deadline(Worker* workers, int count, RunOptions* options) {
+    if (options->wall_limit <= 0) {
         return -1;
-    } else if (pid == 0) {
-        // Child process: execute the solver
-        execl(solver_path, solver_path, cnf_file, NULL);
-        
-        // If execl returns, there was an error
-        perror("Execution failed");
-        exit(EXIT_FAILURE);
-    } else {
-        // Parent process: wait for the child to finish
-        waitpid(pid, &status, 0);
-        
-        gettimeofday(&end, NULL);
-        
-        // Calculate elapsed time in seconds
-        elapsed_time = (end.tv_sec - start.tv_sec) + 
-                       (end.tv_usec - start.tv_usec) / 1000000.0;
-        
-        return elapsed_time;
+    }
+    double earliest = -1;
+    for (int i = 0; i < count; i++) {
+        if (workers[i].pid && !workers[i].killed) {
+            double left = options->wall_limit - elapsed_since(&workers[i].start);
+            if (left < 0) {
+                left = 0;
+            }
+            if (earliest < 0 || left < earliest) {
+                earliest = left;
+            }
+        }
+    }
+    return earliest;
+}
+
+// Run every instance on a pool of workers. Results are stored by instance
+// index; rows are written to output in sorted order as soon as all earlier
+// instances are done, so the CSV is the same whatever the completion order.
+static void run_all(char** files, int file_count, const char* target_dir_path, const char* solver_path,
+                    RunOptions* options, RunResult* results, FILE* output) {
+    Worker workers[MAX_WORKERS];
+    for (int i = 0; i < options->workers; i++) {
+        char name[] = "/tmp/run_cbs_analysis_XXXXXX";
+        workers[i].output = mkstemp(name);
+        if (workers[i].output < 0) {
+            perror("Failed to create temporary file");
+            exit(EXIT_FAILURE);
+        }
+        unlink(name);
+        workers[i].pid = 0;
+    }
+
+    // SIGCHLD is blocked and collected with sigtimedwait, which also wakes us
+    // up in time for the next wall time deadline
+    sigset_t child_signal;
+    sigemptyset(&child_signal);
+    sigaddset(&child_signal, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &child_signal, NULL);
+
+    int next_instance = 0;
+    int next_row = 0;
+    int running = 0;
+    char full_path[MAX_PATH];
+    while (next_row < file_count) {
+        // fill the idle workers
+        for (int i = 0; i < options->workers && next_instance < file_count; i++) {
+            if (workers[i].pid) {
+                continue;
+            }
+            snprintf(full_path, MAX_PATH, "%s/%s", target_dir_path, files[next_instance]);
+            if (start_worker(&workers[i], i, solver_path, full_path, next_instance, options)) {
+                running++;
+            } else {
+                results[next_instance].status = STATUS_ERROR;
+                results[next_instance].done = true;
+            }
+            next_instance++;
+        }
+
+        // collect finished solvers
+        int status;
+        struct rusage usage;
+        pid_t pid;
+        while (running > 0 && (pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+            for (int i = 0; i < options->workers; i++) {
+                if (workers[i].pid != pid) {
+                    continue;
+                }
+                RunResult* result = &results[workers[i].instance];
+                result->wall_time = elapsed_since(&workers[i].start);
+                result->cpu_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+                                 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+                result->status = classify_run(&workers[i], status);
+                result->done = true;
+                printf("  %s: %s %.6f seconds\n", files[workers[i].instance],
+                       status_names[result->status], result->wall_time);
+                workers[i].pid = 0;
+                running--;
+                break;
+            }
+        }
+
+        // write the rows that are ready, in order
+        while (next_row < file_count && results[next_row].done) {
+            RunResult* result = &results[next_row];
+            bool solved = result->status == STATUS_SAT || result->status == STATUS_UNSAT;
+            double par2 = (solved || options->wall_limit <= 0) ? result->wall_time : 2 * options->wall_limit;
+            fprintf(output, "%s,%.6f,%s,%.6f,%.6f\n", files[next_row], result->wall_time,
+                    status_names[result->status], result->cpu_time, par2);
+            // Flush output to ensure results are written even if the program crashes
+            fflush(output);
+            next_row++;
+        }
+        if (next_row >= file_count) {
+            break;
+        }
+        if (running == 0) {
+            continue;
+        }
+
+        // sleep until a solver exits or the next deadline passes
+        double wait = next_deadline(workers, options->workers, options);
+        if (wait < 0) {
+            sigwaitinfo(&child_signal, NULL);
+        } else {
+            struct timespec timeout;
+            timeout.tv_sec = (time_t)wait;
+            timeout.tv_nsec = (long)((wait - timeout.tv_sec) * 1e9);
+            sigtimedwait(&child_signal, NULL, &timeout);
+        }
+
+        // kill the solvers over the wall time limit; they are reaped above
+        for (int i = 0; i < options->workers && options->wall_limit > 0; i++) {
+            if (workers[i].pid && !workers[i].killed && elapsed_since(&workers[i].start) >= options->wall_limit) {
+                kill(workers[i].pid, SIGKILL);
+                workers[i].killed = true;
+            }
+        }
+    }
+
+    sigprocmask(SIG_UNBLOCK, &child_signal, NULL);
+    for (int i = 0; i < options->workers; i++) {
+        close(workers[i].output);
     }
 }
 
 void print_usage(const char *program_name) {
-    printf("Usage: %s <directory_name>\n", program_name);
+    printf("Usage: %s [options] <directory_name>\n", program_name);
     printf("Runs the SAT solver on all .cnf files in examples/<directory_name> and measures execution time.\n");
     printf("Results are saved to <directory_name>_timing_analysis.csv\n");
+    printf("Options:\n");
+    printf("  -j <n>, --jobs=<n>: number of solvers run in parallel (default: 1)\n");
+    printf("  --timeout=<seconds>: wall time limit per instance, also used for PAR-2 (default: none)\n");
+    printf("  --cpu-limit=<seconds>: CPU time limit per instance (default: the wall time limit)\n");
+    printf("  --mem-limit=<MB>: address space limit per instance (default: none)\n");
+    printf("  --pin: pin worker i to CPU i\n");
 }
 
 int main(int argc, char **argv) {
@@ -58,102 +290,125 @@ int main(int argc, char **argv) {
     char target_dir_path[MAX_PATH];
     char solver_path[MAX_PATH] = "../bin/sat_solver";
     char output_file[MAX_PATH];
-    char full_path[MAX_PATH];
     FILE *output;
-    int file_count = 0;
-    
+    RunOptions options = {1, 0, 0, 0, false};
+    const char *target_dir_name = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            options.workers = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            options.workers = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+            options.wall_limit = atof(argv[i] + 10);
+        } else if (strncmp(argv[i], "--cpu-limit=", 12) == 0) {
+            options.cpu_limit = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--mem-limit=", 12) == 0) {
+            options.memory_limit = atol(argv[i] + 12);
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            options.pin = true;
+        } else if (argv[i][0] != '-' && !target_dir_name) {
+            target_dir_name = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
     // Check for directory name argument
-    if (argc != 2) {
+    if (!target_dir_name || options.workers < 1 || options.workers > MAX_WORKERS) {
         print_usage(argv[0]);
         return EXIT_FAILURE;
     }
-    
-    // Use the provided directory name
-    const char *target_dir_name = argv[1];
-    
+    if (options.cpu_limit <= 0) {
+        options.cpu_limit = options.wall_limit;
+    }
+
     // Construct paths using the provided directory name
     snprintf(target_dir_path, MAX_PATH, "%s/%s", examples_dir, target_dir_name);
     snprintf(output_file, MAX_PATH, "%s_timing_analysis.csv", target_dir_name);
-    
+
     printf("Target directory: %s\n", target_dir_path);
     printf("Output file: %s\n", output_file);
-    
+
     // Check if solver exists
     if (access(solver_path, X_OK) != 0) {
         fprintf(stderr, "Error: Solver not found or not executable at %s\n", solver_path);
         fprintf(stderr, "Make sure to build the solver first with 'make' command in the project root\n");
         return EXIT_FAILURE;
     }
-    
-    // Check if target directory exists
-    if (access(target_dir_path, F_OK) != 0) {
-        fprintf(stderr, "Error: Directory %s does not exist\n", target_dir_path);
-        return EXIT_FAILURE;
-    }
-    
+
     // Open the target directory
     dir = opendir(target_dir_path);
     if (!dir) {
         fprintf(stderr, "Error: Could not open directory %s\n", target_dir_path);
         return EXIT_FAILURE;
     }
-    
+
+    // Collect the .cnf files; sorting makes the CSV independent of readdir order
+    char **files = NULL;
+    int file_count = 0, file_capacity = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip . and .. directories and anything that is not a .cnf file
+        if (entry->d_name[0] == '.' || strstr(entry->d_name, ".cnf") == NULL) {
+            continue;
+        }
+        if (file_count == file_capacity) {
+            file_capacity = file_capacity ? 2 * file_capacity : 256;
+            files = realloc(files, file_capacity * sizeof(char *));
+            if (!files) {
+                perror("Failed to allocate memory for the file list");
+                return EXIT_FAILURE;
+            }
+        }
+        files[file_count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+    qsort(files, file_count, sizeof(char *), compare_names);
+
+    if (file_count == 0) {
+        printf("No .cnf files found in %s\n", target_dir_path);
+        free(files);
+        return EXIT_SUCCESS;
+    }
+
     // Create output CSV file
     output = fopen(output_file, "w");
     if (!output) {
         fprintf(stderr, "Error: Could not create output file %s\n", output_file);
-        closedir(dir);
         return EXIT_FAILURE;
     }
-    
-    // Write CSV header
-    fprintf(output, "Filename,Execution Time (seconds)\n");
-    
-    printf("Running SAT solver on examples in %s...\n", target_dir_path);
-    
-    // Process each .cnf file in the directory
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and .. directories
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        // Skip if not a .cnf file
-        if (strstr(entry->d_name, ".cnf") == NULL) {
-            continue;
-        }
-        
-        // Construct full path to the .cnf file
-        snprintf(full_path, MAX_PATH, "%s/%s", target_dir_path, entry->d_name);
-        
-        printf("Processing: %s\n", entry->d_name);
-        
-        // Run solver and measure time
-        double elapsed_time = run_solver(solver_path, full_path);
-        
-        if (elapsed_time >= 0) {
-            // Write result to CSV
-            fprintf(output, "%s,%.6f\n", entry->d_name, elapsed_time);
-            printf("  Time: %.6f seconds\n", elapsed_time);
-            file_count++;
-        } else {
-            fprintf(output, "%s,ERROR\n", entry->d_name);
-            printf("  Error running solver\n");
-        }
-        
-        // Flush output to ensure results are written even if the program crashes
-        fflush(output);
+
+    // Write CSV header; the first two columns are the ones plots.py reads
+    fprintf(output, "Filename,Execution Time (seconds),Status,CPU Time (seconds),PAR-2 (seconds)\n");
+
+    printf("Running SAT solver on %d examples in %s with %d worker(s)...\n",
+           file_count, target_dir_path, options.workers);
+
+    RunResult *results = calloc(file_count, sizeof(RunResult));
+    if (!results) {
+        perror("Failed to allocate memory for the results");
+        return EXIT_FAILURE;
     }
-    
-    // Clean up
+    run_all(files, file_count, target_dir_path, solver_path, &options, results, output);
     fclose(output);
-    closedir(dir);
-    
-    if (file_count > 0) {
-        printf("Analysis complete. Processed %d files. Results written to %s\n", file_count, output_file);
-    } else {
-        printf("No .cnf files found in %s\n", target_dir_path);
+
+    // Summary
+    int counts[5] = {0, 0, 0, 0, 0};
+    double par2_total = 0;
+    for (int i = 0; i < file_count; i++) {
+        counts[results[i].status]++;
+        bool solved = results[i].status == STATUS_SAT || results[i].status == STATUS_UNSAT;
+        par2_total += (solved || options.wall_limit <= 0) ? results[i].wall_time : 2 * options.wall_limit;
     }
-    
+    printf("Analysis complete. Processed %d files. Results written to %s\n", file_count, output_file);
+    printf("  SAT: %d, UNSAT: %d, TIMEOUT: %d, MEMOUT: %d, ERROR: %d\n",
+           counts[STATUS_SAT], counts[STATUS_UNSAT], counts[STATUS_TIMEOUT], counts[STATUS_MEMOUT], counts[STATUS_ERROR]);
+    printf("  PAR-2 score: %.3f seconds total, %.6f seconds mean\n", par2_total, par2_total / file_count);
+
+    for (int i = 0; i < file_count; i++) {
+        free(files[i]);
+    }
+    free(files);
+    free(results);
     return EXIT_SUCCESS;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Generator of random and structured CNF formulas in DIMACS format, for
+// stress tests and scaling benchmarks of the solver. Every family is
+// reproducible from --seed; the same arguments give the same file.
+
+#define OUTPUT_BUFFER (1 << 20)
+#define MAX_K 16      // longest random clause
+#define MAX_XOR_K 10  // an XOR of k variables takes 2^(k-1) clauses
+
+#define FAMILY_KSAT 0
+#define FAMILY_PLANTED 1
+#define FAMILY_PHP 2
+#define FAMILY_XOR 3
+#define FAMILY_PARITY 4
+
+static const char* family_names[] = {"ksat", "planted", "php", "xor", "parity"};
+
+// Approximate satisfiability thresholds of random k-SAT, the default ratio
+static const double threshold_ratio[] = {0, 0, 1.0, 4.26, 9.93, 21.12, 43.37, 87.79};
+
+typedef struct {
+    int family;
+    long long vars;
+    int k;
+    double ratio;
+    long long clauses;    // -1 if it follows from the ratio
+    long long total_vars; // of the DIMACS header, with the auxiliary ones
+    int backbone;         // planted: percent of the variables in the backbone
+    int pigeons;
+    int holes;
+    bool unsat;           // parity: the two chains must disagree
+    uint64_t seed;
+    const char* output;
+} GeneratorOptions;
+
+// xoshiro256**, seeded through splitmix64
+typedef struct {
+    uint64_t s[4];
+} Random;
+
+static uint64_t rotate_left(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static void seed_random(Random* random, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        random->s[i] = z ^ (z >> 31);
+    }
+}
+
+static uint64_t next_random(Random* random) {
+    uint64_t* s = random->s;
+    uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate_left(s[3], 45);
+    return result;
+}
+
+// Uniform in [0, bound), by multiplying instead of the slower modulo
+static long long random_below(Random* random, long long bound) {
+    return (long long)(((unsigned __int128)next_random(random) * (uint64_t)bound) >> 64);
+}
+
+// Buffered DIMACS writer; numbers are formatted by hand, printf is the bottleneck otherwise
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t size;
+} Writer;
+
+static void flush_writer(Writer* writer) {
+    if (writer->size > 0 && fwrite(writer->buffer, 1, writer->size, writer->file) != writer->size) {
+        perror("Failed to write the formula");
+        exit(EXIT_FAILURE);
+    }
+    writer->size = 0;
+}
+
+static void write_literal(Writer* writer, long long literal) {
+    if (writer->size + 24 > OUTPUT_BUFFER) {
+        flush_writer(writer);
+    }
+    char digits[24];
+    int n = 0;
+    unsigned long long value = literal < 0 ? -(unsigned long long)literal : (unsigned long long)literal;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    char* out = writer->buffer + writer->size;
+    if (literal < 0) {
+        *out++ = '-';
+    }
+    while (n > 0) {
+        *out++ = digits[--n];
+    }
+    *out++ = ' ';
+    writer->size = out - writer->buffer;
+}
+
+static void end_clause(Writer* writer) {
+    if (writer->size + 2 > OUTPUT_BUFFER) {
+        flush_writer(writer);
+    }
+    writer->buffer[writer->size++] = '0';
+    writer->buffer[writer->size++] = '\n';
+}
+
+static void write_clause(Writer* writer, const long long* literals, int size) {
+    for (int i = 0; i < size; i++) {
+        write_literal(writer, literals[i]);
+    }
+    end_clause(writer);
+}
+
+static void* allocate(size_t size) {
+    void* array = malloc(size ? size : 1);
+    if (!array) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+// k distinct variables, in 1..vars
+static void random_variables(Random* random, long long vars, int k, long long* clause) {
+    for (int i = 0; i < k; i++) {
+        bool repeated;
+        do {
+            clause[i] = random_below(random, vars) + 1;
+            repeated = false;
+            for (int j = 0; j < i; j++) {
+                repeated = repeated || clause[j] == clause[i];
+            }
+        } while (repeated);
+    }
+}
+
+// Uniform random k-SAT: every clause has k distinct variables with random signs
+static void generate_ksat(Writer* writer, Random* random, const GeneratorOptions* options) {
+    long long clause[MAX_K];
+    for (long long c = 0; c < options->clauses; c++) {
+        random_variables(random, options->vars, options->k, clause);
+        for (int i = 0; i < options->k; i++) {
+            if (next_random(random) >> 63) {
+                clause[i] = -clause[i];
+            }
+        }
+        write_clause(writer, clause, options->k);
+    }
+}
+
+// Planted k-SAT with a controlled backbone, in the manner of the CBS families:
+// a hidden solution is drawn, and a random clause is kept only if one of its
+// literals agrees with the solution on a variable of the backbone set (the
+// first backbone% of the variables in a random order). Every assignment that
+// agrees with the solution on that set is then a model, so the backbone has at
+// most that many variables. With --backbone=0 a clause is kept if it has a
+// literal true and a literal false in the solution: the solution and its
+// complement are both models, so no variable is in the backbone.
+static void generate_planted(Writer* writer, Random* random, const GeneratorOptions* options) {
+    long long n = options->vars;
+    bool* solution = (bool*)allocate(n + 1);
+    bool* backbone = (bool*)allocate(n + 1);
+    long long* order = (long long*)allocate(n * sizeof(long long));
+    for (long long v = 1; v <= n; v++) {
+        solution[v] = next_random(random) >> 63;
+        order[v - 1] = v;
+        backbone[v] = false;
+    }
+    long long backbone_size = (n * options->backbone + 99) / 100;
+    for (long long i = 0; i < backbone_size; i++) {
+        long long j = i + random_below(random, n - i);
+        long long v = order[j];
+        order[j] = order[i];
+        order[i] = v;
+        backbone[v] = true;
+    }
+    free(order);
+
+    long long clause[MAX_K];
+    for (long long c = 0; c < options->clauses; c++) {
+        bool kept;
+        do {
+            random_variables(random, n, options->k, clause);
+            kept = false;
+            bool agrees = false, disagrees = false;
+            for (int i = 0; i < options->k; i++) {
+                bool positive = next_random(random) >> 63;
+                kept = kept || (backbone[clause[i]] && positive == solution[clause[i]]);
+                agrees = agrees || positive == solution[clause[i]];
+                disagrees = disagrees || positive != solution[clause[i]];
+                if (!positive) {
+                    clause[i] = -clause[i];
+                }
+            }
+            if (options->backbone == 0) {
+                kept = agrees && disagrees;
+            }
+        } while (!kept);
+        write_clause(writer, clause, options->k);
+    }
+    free(solution);
+    free(backbone);
+}
+
+// Pigeonhole: variable (i - 1) * holes + j means pigeon i sits in hole j,
+// as in examples/pigeonhole.cnf. Unsatisfiable when pigeons > holes.
+static void generate_php(Writer* writer, const GeneratorOptions* options) {
+    long long clause[2];
+    for (long long i = 1; i <= options->pigeons; i++) {
+        for (long long j = 1; j <= options->holes; j++) {
+            write_literal(writer, (i - 1) * options->holes + j);
+        }
+        end_clause(writer);
+    }
+    for (long long j = 1; j <= options->holes; j++) {
+        for (long long i = 1; i <= options->pigeons; i++) {
+            for (long long l = i + 1; l <= options->pigeons; l++) {
+                clause[0] = -((i - 1) * options->holes + j);
+                clause[1] = -((l - 1) * options->holes + j);
+                write_clause(writer, clause, 2);
+            }
+        }
+    }
+}
+
+// The clauses of x_1 XOR ... XOR x_k = parity: one per assignment of the
+// wrong parity, false exactly on it
+static void write_xor(Writer* writer, const long long* variables, int k, bool parity) {
+    long long clause[MAX_XOR_K];
+    for (unsigned int bits = 0; bits < (1u << k); bits++) {
+        if ((__builtin_popcount(bits) & 1) == parity) {
+            continue;
+        }
+        for (int i = 0; i < k; i++) {
+            clause[i] = (bits >> i) & 1 ? -variables[i] : variables[i];
+        }
+        write_clause(writer, clause, k);
+    }
+}
+
+// Random k-XOR-SAT with planted parities: constraints on k distinct variables,
+// each with the parity of a hidden solution, so it is satisfiable
+static void generate_xor(Writer* writer, Random* random, const GeneratorOptions* options) {
+    long long n = options->vars;
+    bool* solution = (bool*)allocate(n + 1);
+    for (long long v = 1; v <= n; v++) {
+        solution[v] = next_random(random) >> 63;
+    }
+    long long variables[MAX_XOR_K];
+    long long constraints = options->clauses >> (options->k - 1);
+    for (long long c = 0; c < constraints; c++) {
+        random_variables(random, n, options->k, variables);
+        bool parity = false;
+        for (int i = 0; i < options->k; i++) {
+            parity ^= solution[variables[i]];
+        }
+        write_xor(writer, variables, options->k, parity);
+    }
+    free(solution);
+}
+
+// Two XOR chains over x_1..x_n: t_i = t_(i-1) XOR x_i with the variables in
+// order, and the same with them in a random order. Both totals are asserted
+// true, or (--unsat) the second false, which contradicts as both compute the
+// parity of the same variables. Without XOR reasoning, the solver has to
+// relate two chains that share nothing but the inputs.
+static void generate_parity(Writer* writer, Random* random, const GeneratorOptions* options) {
+    long long n = options->vars;
+    long long* order = (long long*)allocate(n * sizeof(long long));
+    for (long long i = 0; i < n; i++) {
+        order[i] = i + 1;
+    }
+    for (long long i = n - 1; i > 0; i--) {
+        long long j = random_below(random, i + 1);
+        long long v = order[i];
+        order[i] = order[j];
+        order[j] = v;
+    }
+    long long next_variable = n + 1;
+    long long totals[2];
+    for (int chain = 0; chain < 2; chain++) {
+        long long total = chain == 0 ? 1 : order[0];
+        for (long long i = 1; i < n; i++) {
+            long long gate[3] = {total, chain == 0 ? i + 1 : order[i], next_variable};
+            write_xor(writer, gate, 3, false);
+            total = next_variable++;
+        }
+        totals[chain] = total;
+    }
+    free(order);
+    write_literal(writer, totals[0]);
+    end_clause(writer);
+    write_literal(writer, options->unsat ? -totals[1] : totals[1]);
+    end_clause(writer);
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s <family> [options]\n", program_name);
+    fprintf(stderr, "Families:\n");
+    fprintf(stderr, "  ksat     uniform random k-SAT (--vars, --k, --ratio or --clauses)\n");
+    fprintf(stderr, "  planted  k-SAT with a hidden solution and a controlled backbone, like CBS (--backbone)\n");
+    fprintf(stderr, "  php      pigeonhole, --pigeons into --holes (default: holes + 1 pigeons)\n");
+    fprintf(stderr, "  xor      random k-XOR-SAT with planted parities, --ratio XOR constraints per variable\n");
+    fprintf(stderr, "  parity   two XOR chains over --vars variables in different orders (--unsat: contradicting)\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --vars=<n>: number of variables (default: 100)\n");
+    fprintf(stderr, "  --k=<n>: literals per clause or variables per XOR (default: 3)\n");
+    fprintf(stderr, "  --ratio=<r>: clauses per variable (default: the threshold for k-SAT, 4.26 for k = 3;\n");
+    fprintf(stderr, "               constraints per variable for xor, default 0.8)\n");
+    fprintf(stderr, "  --clauses=<m>: number of clauses, instead of --ratio\n");
+    fprintf(stderr, "  --backbone=<percent>: planted: share of the variables in the backbone (default: 100)\n");
+    fprintf(stderr, "  --pigeons=<n>, --holes=<n>: php sizes (default: 10 holes)\n");
+    fprintf(stderr, "  --unsat: parity: make the chains disagree\n");
+    fprintf(stderr, "  --seed=<n>: seed of the generator (default: 1)\n");
+    fprintf(stderr, "  -o <file>, --output=<file>: write to <file> instead of stdout\n");
+}
+
+static bool parse_arguments(int argc, char* argv[], GeneratorOptions* options) {
+    if (argc < 2) {
+        return false;
+    }
+    options->family = -1;
+    for (int f = 0; f < (int)(sizeof(family_names) / sizeof(family_names[0])); f++) {
+        if (strcmp(argv[1], family_names[f]) == 0) {
+            options->family = f;
+        }
+    }
+    if (options->family < 0) {
+        return false;
+    }
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--vars=", 7) == 0) {
+            options->vars = atoll(arg + 7);
+        } else if (strncmp(arg, "--k=", 4) == 0) {
+            options->k = atoi(arg + 4);
+        } else if (strncmp(arg, "--ratio=", 8) == 0) {
+            options->ratio = atof(arg + 8);
+        } else if (strncmp(arg, "--clauses=", 10) == 0) {
+            options->clauses = atoll(arg + 10);
+        } else if (strncmp(arg, "--backbone=", 11) == 0) {
+            options->backbone = atoi(arg + 11);
+        } else if (strncmp(arg, "--pigeons=", 10) == 0) {
+            options->pigeons = atoi(arg + 10);
+        } else if (strncmp(arg, "--holes=", 8) == 0) {
+            options->holes = atoi(arg + 8);
+        } else if (strcmp(arg, "--unsat") == 0) {
+            options->unsat = true;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            options->seed = strtoull(arg + 7, NULL, 10);
+        } else if (strncmp(arg, "--output=", 9) == 0) {
+            options->output = arg + 9;
+        } else if (strcmp(arg, "-o") == 0 && i + 1 < argc) {
+            options->output = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fill in the defaults that depend on the family and check the sizes.
+// Sets the number of variables and clauses of the DIMACS header.
+static bool resolve_sizes(GeneratorOptions* options) {
+    options->total_vars = options->vars;
+    switch (options->family) {
+    case FAMILY_KSAT:
+    case FAMILY_PLANTED:
+        if (options->k < 1 || options->k > MAX_K || options->vars < options->k) {
+            fprintf(stderr, "Need 1 <= k <= %d and at least k variables\n", MAX_K);
+            return false;
+        }
+        if (options->ratio < 0) {
+            if (options->k >= (int)(sizeof(threshold_ratio) / sizeof(threshold_ratio[0]))) {
+                fprintf(stderr, "No default ratio for k = %d, give --ratio or --clauses\n", options->k);
+                return false;
+            }
+            options->ratio = threshold_ratio[options->k];
+        }
+        if (options->backbone < 0 || options->backbone > 100) {
+            fprintf(stderr, "The backbone is a percentage in 0..100\n");
+            return false;
+        }
+        if (options->family == FAMILY_PLANTED && options->backbone == 0 && options->k < 2) {
+            fprintf(stderr, "An empty backbone needs clauses of at least 2 literals\n");
+            return false;
+        }
+        break;
+    case FAMILY_PHP:
+        if (options->holes < 1) {
+            fprintf(stderr, "Need at least one hole\n");
+            return false;
+        }
+        if (options->pigeons <= 0) {
+            options->pigeons = options->holes + 1;
+        }
+        options->total_vars = (long long)options->pigeons * options->holes;
+        options->clauses = options->pigeons
+            + (long long)options->holes * options->pigeons * (options->pigeons - 1) / 2;
+        return true;
+    case FAMILY_XOR:
+        if (options->k < 1 || options->k > MAX_XOR_K || options->vars < options->k) {
+            fprintf(stderr, "Need 1 <= k <= %d and at least k variables\n", MAX_XOR_K);
+            return false;
+        }
+        if (options->ratio < 0) {
+            options->ratio = 0.8;
+        }
+        // counted in XOR constraints until here
+        options->clauses = (options->clauses >= 0 ? options->clauses : (long long)(options->ratio * options->vars + 0.5))
+            << (options->k - 1);
+        break;
+    case FAMILY_PARITY:
+        if (options->vars < 2) {
+            fprintf(stderr, "Need at least two variables\n");
+            return false;
+        }
+        options->clauses = 2 * 4 * (options->vars - 1) + 2;
+        options->total_vars = options->vars + 2 * (options->vars - 1);
+        return true;
+    }
+    if (options->clauses < 0) {
+        options->clauses = (long long)(options->ratio * options->vars + 0.5);
+    }
+    // DIMACS readers, this solver's included, want at least one clause
+    if (options->clauses < 1) {
+        fprintf(stderr, "No clauses to write, give a larger --ratio or --clauses\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options = {FAMILY_KSAT, 100, 3, -1, -1, 0, 100, 0, 10, false, 1, NULL};
+    if (!parse_arguments(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!resolve_sizes(&options)) {
+        return EXIT_FAILURE;
+    }
+
+    Writer writer = {stdout, (char*)allocate(OUTPUT_BUFFER), 0};
+    if (options.output && !(writer.file = fopen(options.output, "w"))) {
+        perror("Failed to open the output file");
+        return EXIT_FAILURE;
+    }
+    Random random;
+    seed_random(&random, options.seed);
+
+    fprintf(writer.file, "c generated: %s", family_names[options.family]);
+    switch (options.family) {
+    case FAMILY_KSAT:
+        fprintf(writer.file, " --vars=%lld --k=%d --clauses=%lld", options.vars, options.k, options.clauses);
+        break;
+    case FAMILY_PLANTED:
+        fprintf(writer.file, " --vars=%lld --k=%d --clauses=%lld --backbone=%d",
+                options.vars, options.k, options.clauses, options.backbone);
+        break;
+    case FAMILY_PHP:
+        fprintf(writer.file, " --pigeons=%d --holes=%d", options.pigeons, options.holes);
+        break;
+    case FAMILY_XOR:
+        fprintf(writer.file, " --vars=%lld --k=%d --clauses=%lld", options.vars, options.k, options.clauses);
+        break;
+    case FAMILY_PARITY:
+        fprintf(writer.file, " --vars=%lld%s", options.vars, options.unsat ? " --unsat" : "");
+        break;
+    }
+    fprintf(writer.file, " --seed=%llu\np cnf %lld %lld\n", (unsigned long long)options.seed, options.total_vars, options.clauses);
+
+    switch (options.family) {
+    case FAMILY_KSAT:
+        generate_ksat(&writer, &random, &options);
+        break;
+    case FAMILY_PLANTED:
+        generate_planted(&writer, &random, &options);
+        break;
+    case FAMILY_PHP:
+        generate_php(&writer, &options);
+        break;
+    case FAMILY_XOR:
+        generate_xor(&writer, &random, &options);
+        break;
+    case FAMILY_PARITY:
+        generate_parity(&writer, &random, &options);
+        break;
+    }
+    flush_writer(&writer);
+    free(writer.buffer);
+    if (writer.file != stdout && fclose(writer.file) != 0) {
+        perror("Failed to write the formula");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
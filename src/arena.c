@@ -0,0 +1,122 @@
+#include "sat.h"
+
+// Clause arena. Every clause of a formula is stored inline in one growing
+// array of 32-bit words: a StoredClause header followed by its literals.
+// Clauses are referenced by their word offset, which stays valid when the
+// array is reallocated. Deleted clauses leave holes that collect_garbage()
+// squeezes out by copying the live clauses into a fresh arena.
+
+#define ARENA_INITIAL_CAPACITY 4096
+
+void init_arena(ClauseArena* arena) {
+    arena->memory = (uint32_t*)malloc(ARENA_INITIAL_CAPACITY * sizeof(uint32_t));
+    if (!arena->memory) {
+        perror("Failed to allocate memory for clause arena");
+        exit(EXIT_FAILURE);
+    }
+    arena->size = 0;
+    arena->capacity = ARENA_INITIAL_CAPACITY;
+    arena->wasted = 0;
+}
+
+void free_arena(ClauseArena* arena) {
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->size = 0;
+    arena->capacity = 0;
+    arena->wasted = 0;
+}
+
+static uint32_t clause_words(int size) {
+    return CLAUSE_HEADER_WORDS + size;
+}
+
+// Reserve a clause of the given size. literals may be NULL, in which case
+// the caller fills them in. Pointers into the arena are invalidated.
+ClauseRef arena_alloc_clause(ClauseArena* arena, const Lit* literals, int size, bool learned) {
+    uint32_t words = clause_words(size);
+    if (arena->size + words > arena->capacity) {
+        uint64_t capacity = arena->capacity;
+        while (arena->size + words > capacity) {
+            capacity *= 2;
+        }
+        if (capacity >= CLAUSE_REF_NONE) {
+            fprintf(stderr, "Clause arena exceeds 32-bit references\n");
+            exit(EXIT_FAILURE);
+        }
+        arena->memory = (uint32_t*)realloc(arena->memory, capacity * sizeof(uint32_t));
+        if (!arena->memory) {
+            perror("Failed to reallocate memory for clause arena");
+            exit(EXIT_FAILURE);
+        }
+        arena->capacity = (uint32_t)capacity;
+    }
+
+    ClauseRef ref = arena->size;
+    StoredClause* clause = (StoredClause*)(arena->memory + ref);
+    clause->size = size;
+    clause->learned = learned;
+    clause->used = false;
+    clause->deleted = false;
+    clause->relocated = false;
+    clause->imported = false;
+    clause->lbd = 0;
+    clause->activity = 0;
+    if (literals) {
+        memcpy(clause->literals, literals, size * sizeof(Lit));
+    }
+    arena->size += words;
+    return ref;
+}
+
+// Mark a clause as deleted. Its memory is reclaimed by the next collect_garbage().
+void delete_clause(Formula* formula, ClauseRef ref) {
+    StoredClause* clause = clause_at(formula, ref);
+    if (formula->proof) {
+        proof_delete(formula->proof, clause->literals, clause->size);
+    }
+    clause->deleted = true;
+    formula->arena.wasted += clause_words(clause->size);
+}
+
+// Copy a live clause into the new arena once, leaving a forwarding reference behind
+static ClauseRef relocate(Formula* formula, ClauseArena* target, ClauseRef ref) {
+    StoredClause* clause = clause_at(formula, ref);
+    if (!clause->relocated) {
+        ClauseRef moved = arena_alloc_clause(target, clause->literals, clause->size, clause->learned);
+        StoredClause* copy = (StoredClause*)(target->memory + moved);
+        copy->used = clause->used;
+        copy->imported = clause->imported;
+        copy->lbd = clause->lbd;
+        copy->activity = clause->activity;
+        clause->relocated = true;
+        clause->relocation = moved;
+    }
+    return clause->relocation;
+}
+
+// Compact the arena: live clauses are copied into a fresh arena in the order
+// of the original and learned lists, every reference (clause lists,
+// antecedents on the trail, watch lists) is moved to the new offsets.
+void collect_garbage(Formula* formula, Assignment* assignment) {
+    ClauseArena target;
+    init_arena(&target);
+
+    for (int i = 0; i < formula->size; i++) {
+        formula->clauses[i] = relocate(formula, &target, formula->clauses[i]);
+    }
+    for (int i = 0; i < formula->num_learned; i++) {
+        formula->learned[i] = relocate(formula, &target, formula->learned[i]);
+    }
+    // antecedents are locked, so they are never deleted
+    for (int i = 0; i < assignment->trail_size; i++) {
+        int var = lit_var(assignment->trail[i]);
+        if (assignment->vars[var].reason != ANTECEDENT_CLAUSE_NONE) {
+            assignment->vars[var].reason = relocate(formula, &target, assignment->vars[var].reason);
+        }
+    }
+
+    free_arena(&formula->arena);
+    formula->arena = target;
+    rebuild_watches(formula);
+}
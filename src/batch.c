@@ -0,0 +1,236 @@
+#include "sat.h"
+#include <dirent.h>
+#include <glob.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Batch mode: solve many instances in one process and write one CSV row per
+// instance. The parsed formula, the preprocessor with its simplified formula
+// and the assignment are recycled from one instance to the next, so after
+// the first few instances a run allocates almost nothing.
+// Instances come from a directory (every file with ".cnf" in its name), a
+// glob pattern, or a list file with one path per line.
+
+typedef struct {
+    char** paths;
+    int size;
+    int capacity;
+} PathList;
+
+static void add_path(PathList* list, const char* path) {
+    if (list->size >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->paths = (char**)realloc(list->paths, list->capacity * sizeof(char*));
+        if (!list->paths) {
+            perror("Failed to reallocate memory for instance list");
+            exit(EXIT_FAILURE);
+        }
+    }
+    list->paths[list->size] = strdup(path);
+    if (!list->paths[list->size]) {
+        perror("Failed to allocate memory for instance path");
+        exit(EXIT_FAILURE);
+    }
+    list->size++;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static bool collect_directory(PathList* list, const char* directory) {
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        perror("Failed to open directory");
+        return false;
+    }
+    struct dirent* entry;
+    char path[4096];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || strstr(entry->d_name, ".cnf") == NULL) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        add_path(list, path);
+    }
+    closedir(dir);
+    // readdir order depends on the file system
+    qsort(list->paths, list->size, sizeof(char*), compare_paths);
+    return true;
+}
+
+static bool collect_glob(PathList* list, const char* pattern) {
+    glob_t matches;
+    int status = glob(pattern, 0, NULL, &matches);
+    if (status == GLOB_NOMATCH) {
+        return true;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Failed to expand pattern: %s\n", pattern);
+        return false;
+    }
+    for (size_t i = 0; i < matches.gl_pathc; i++) {
+        add_path(list, matches.gl_pathv[i]);
+    }
+    globfree(&matches);
+    return true;
+}
+
+// One path per line, blank lines and lines starting with '#' are ignored
+static bool collect_list_file(PathList* list, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        perror("Failed to open instance list");
+        return false;
+    }
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &line_capacity, file)) >= 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        add_path(list, line);
+    }
+    free(line);
+    fclose(file);
+    return true;
+}
+
+static bool collect_instances(PathList* list, const char* source) {
+    struct stat info;
+    if (stat(source, &info) == 0 && S_ISDIR(info.st_mode)) {
+        return collect_directory(list, source);
+    }
+    if (strpbrk(source, "*?[")) {
+        return collect_glob(list, source);
+    }
+    return collect_list_file(list, source);
+}
+
+// Start a new peak memory measurement. Linux can reset the peak resident
+// set size of a process; elsewhere the peak of the whole run is reported.
+static void reset_peak_memory() {
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file) {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+// Peak resident set size in KiB since the last reset_peak_memory()
+static long peak_memory_kb() {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file) {
+        char line[256];
+        long peak = -1;
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                peak = strtol(line + 6, NULL, 10);
+                break;
+            }
+        }
+        fclose(file);
+        if (peak >= 0) {
+            return peak;
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Quote a CSV field if it needs it
+static void write_csv_field(FILE* csv, const char* field) {
+    if (!strpbrk(field, ",\"\n")) {
+        fputs(field, csv);
+        return;
+    }
+    fputc('"', csv);
+    for (const char* c = field; *c; c++) {
+        if (*c == '"') {
+            fputc('"', csv);
+        }
+        fputc(*c, csv);
+    }
+    fputc('"', csv);
+}
+
+// Solve every instance named by source and write a CSV row for each to csv.
+// Returns the number of instances that could not be parsed, or -1 if the
+// instance list itself could not be read.
+int run_batch(const char* source, SolverOptions* options, FILE* csv) {
+    PathList list = {NULL, 0, 0};
+    if (!collect_instances(&list, source)) {
+        return -1;
+    }
+
+    fprintf(csv, "Filename,Result,Parse Time (seconds),Solve Time (seconds),Conflicts,Decisions,Propagations,Peak Memory (KB)\n");
+
+    Formula* formula = NULL;
+    Preprocessor* preprocessor = NULL;
+    Formula* simplified = NULL;
+    Assignment* assignment = NULL;
+    ReconstructionStack eliminated = {NULL, 0, 0};
+    int errors = 0;
+    for (int i = 0; i < list.size; i++) {
+        const char* path = list.paths[i];
+        reset_peak_memory();
+
+        double start = stats_clock();
+        Formula* parsed = parse_cnf_file_into(path, formula);
+        double parsed_at = stats_clock();
+        if (!parsed) {
+            write_csv_field(csv, path);
+            fprintf(csv, ",ERROR,%.6f,,,,,%ld\n", parsed_at - start, peak_memory_kb());
+            fflush(csv);
+            errors++;
+            continue;
+        }
+        formula = parsed;
+
+        // the same pipeline as a single instance: the solve time includes
+        // preprocessing and the extension of the model
+        eliminated.size = 0;
+        Formula* searched = formula;
+        if (options->preprocess) {
+            simplified = preprocess_formula_into(formula, &eliminated, options->probe, NULL, &preprocessor, simplified);
+            searched = simplified;
+        } else if (options->probe) {
+            probe_search_formula(formula, &eliminated, NULL);
+        }
+        assignment = recycle_assignment(assignment, searched->num_variables);
+        assignment->options = *options;
+        bool result = solve(searched, assignment);
+        if (result) {
+            extend_model(&eliminated, assignment);
+        }
+        double solved_at = stats_clock();
+
+        write_csv_field(csv, path);
+        fprintf(csv, ",%s,%.6f,%.6f,%lld,%lld,%lld,%ld\n", result ? "SAT" : assignment->interrupted ? "UNKNOWN" : "UNSAT",
+                parsed_at - start, solved_at - parsed_at,
+                assignment->conflicts, assignment->decisions, assignment->propagations,
+                peak_memory_kb());
+        // rows survive a crash or a killed run
+        fflush(csv);
+    }
+
+    if (assignment) {
+        free_assignment(assignment);
+    }
+    if (formula) {
+        free_formula(formula);
+    }
+    free_formula(simplified);
+    free_preprocessor(preprocessor);
+    free_reconstruction(&eliminated);
+    for (int i = 0; i < list.size; i++) {
+        free(list.paths[i]);
+    }
+    free(list.paths);
+    return errors;
+}
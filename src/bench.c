@@ -0,0 +1,468 @@
+#include "sat.h"
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+
+// Microbenchmarks (make bench). Each kernel is timed BENCH_REPEATS times
+// after BENCH_WARMUP untimed runs, on inputs that depend only on BENCH_SEED,
+// so two runs do the same work and differ only in speed:
+//   propagate/*  propagations per second of random descents (decide, propagate, undo)
+//   analyze/*    microseconds per conflict_analysis call during a random-decision search
+//   parse/*      MB/s of parse_cnf_buffer on a generated DIMACS text
+//   solve/*      milliseconds to preprocess and solve a pinned set of examples/
+// Every benchmark prints its median, 10th and 90th percentiles and relative
+// standard deviation, and is written as one JSON object per line to the
+// output file. Given the file of an earlier run, medians are compared and a
+// change for the worse by more than BENCH_TOLERANCE counts as a regression.
+
+typedef struct {
+    FILE* output;
+    char* baseline; //contents of the baseline file, NULL if there is none
+    int repeats;
+    int regressions;
+} BenchRun;
+
+// xorshift64*, independent of the solver's generator and of rand()
+static unsigned long long bench_random(unsigned long long* state) {
+    unsigned long long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} TextBuffer;
+
+static void append_text(TextBuffer* text, const char* data, size_t size) {
+    if (text->size + size > text->capacity) {
+        text->capacity = text->capacity ? 2 * text->capacity : 1 << 16;
+        if (text->capacity < text->size + size) {
+            text->capacity = text->size + size;
+        }
+        text->data = (char*)realloc(text->data, text->capacity);
+        if (!text->data) {
+            perror("Failed to allocate memory for benchmarks");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(text->data + text->size, data, size);
+    text->size += size;
+}
+
+// Uniform random k-SAT in DIMACS, k distinct variables per clause
+static TextBuffer random_cnf(unsigned long long seed, int num_vars, int num_clauses, int k) {
+    TextBuffer text = {NULL, 0, 0};
+    unsigned long long state = seed;
+    char line[64];
+    int length = snprintf(line, sizeof line, "p cnf %d %d\n", num_vars, num_clauses);
+    append_text(&text, line, length);
+    int* clause = (int*)allocate_memory(k * sizeof(int), "benchmarks");
+    for (int i = 0; i < num_clauses; i++) {
+        for (int j = 0; j < k; j++) {
+            int var;
+            bool repeated;
+            do {
+                var = (int)(bench_random(&state) % num_vars) + 1;
+                repeated = false;
+                for (int l = 0; l < j; l++) {
+                    repeated = repeated || clause[l] == var;
+                }
+            } while (repeated);
+            clause[j] = var;
+            length = snprintf(line, sizeof line, "%d ", bench_random(&state) & 1 ? var : -var);
+            append_text(&text, line, length);
+        }
+        append_text(&text, "0\n", 2);
+    }
+    free(clause);
+    return text;
+}
+
+static Formula* parse_text(TextBuffer* text) {
+    Formula* formula = parse_cnf_buffer(text->data, text->size);
+    if (!formula) {
+        fprintf(stderr, "Failed to parse a generated formula\n");
+        exit(EXIT_FAILURE);
+    }
+    return formula;
+}
+
+// Formula ready for propagation: watches attached and level 0 propagated
+static Assignment* prepare_search(Formula* formula) {
+    ClauseRef conflict;
+    Assignment* assignment = create_assignment(formula->num_variables);
+    assignment->options = default_solver_options();
+    init_watches(formula);
+    if (!assign_unit_clauses(formula, assignment)
+        || unit_propagation(formula, assignment, &conflict) == UIP_CONFLICT) {
+        fprintf(stderr, "Benchmark formula is refuted at level 0\n");
+        exit(EXIT_FAILURE);
+    }
+    return assignment;
+}
+
+// Random decisions: the variables in a shuffled order, each descent starting
+// at a random point of it, with random signs
+typedef struct {
+    unsigned long long state;
+    int* order;
+    int next;
+} RandomDecisions;
+
+static RandomDecisions random_decisions(int num_vars) {
+    RandomDecisions decisions = {BENCH_SEED, (int*)allocate_memory(num_vars * sizeof(int), "benchmarks"), 0};
+    for (int i = 0; i < num_vars; i++) {
+        decisions.order[i] = i;
+    }
+    for (int i = num_vars - 1; i > 0; i--) {
+        int j = (int)(bench_random(&decisions.state) % (i + 1));
+        int var = decisions.order[i];
+        decisions.order[i] = decisions.order[j];
+        decisions.order[j] = var;
+    }
+    return decisions;
+}
+
+static void restart_decisions(RandomDecisions* decisions, int num_vars) {
+    decisions->next = (int)(bench_random(&decisions->state) % num_vars);
+}
+
+// A new level deciding the next free variable, false if none is left
+static bool decide_random(Assignment* assignment, RandomDecisions* decisions) {
+    if (assignment->trail_size == assignment->size) {
+        return false;
+    }
+    int var = decisions->order[decisions->next];
+    while (variable_assigned(assignment, var)) {
+        decisions->next = decisions->next + 1 == assignment->size ? 0 : decisions->next + 1;
+        var = decisions->order[decisions->next];
+    }
+    new_decision_level(assignment);
+    assign_literal(assignment, make_lit(var, bench_random(&decisions->state) & 1), ANTECEDENT_CLAUSE_NONE);
+    return true;
+}
+
+static double propagation_sample(TextBuffer* text, int descents) {
+    ClauseRef conflict;
+    Formula* formula = parse_text(text);
+    Assignment* assignment = prepare_search(formula);
+    RandomDecisions decisions = random_decisions(assignment->size);
+    long long propagations = assignment->propagations;
+
+    double start = stats_clock();
+    for (int i = 0; i < descents; i++) {
+        restart_decisions(&decisions, assignment->size);
+        while (decide_random(assignment, &decisions)
+               && unit_propagation(formula, assignment, &conflict) != UIP_CONFLICT) {
+        }
+        backtrack_assignment(assignment, 0);
+    }
+    double seconds = stats_clock() - start;
+
+    propagations = assignment->propagations - propagations;
+    free(decisions.order);
+    free_assignment(assignment);
+    free_formula(formula);
+    return propagations / seconds;
+}
+
+static double analysis_sample(TextBuffer* text, int conflicts) {
+    ClauseRef conflict;
+    Formula* formula = parse_text(text);
+    Assignment* assignment = prepare_search(formula);
+    RandomDecisions decisions = random_decisions(assignment->size);
+
+    double seconds = 0;
+    int analyzed = 0;
+    while (analyzed < conflicts) {
+        if (!decide_random(assignment, &decisions)) {
+            // a model: start over, keeping the learned clauses
+            backtrack_assignment(assignment, 0);
+            restart_decisions(&decisions, assignment->size);
+            continue;
+        }
+        while (unit_propagation(formula, assignment, &conflict) == UIP_CONFLICT) {
+            double start = stats_clock();
+            int b = conflict_analysis(formula, conflict, assignment);
+            seconds += stats_clock() - start;
+            analyzed++;
+            if (b < 0) {
+                fprintf(stderr, "Benchmark formula is unsatisfiable after %d conflicts\n", analyzed);
+                exit(EXIT_FAILURE);
+            }
+            ClauseRef learned_ref = formula->learned[formula->num_learned - 1];
+            backtrack_assignment(assignment, b);
+            assign_literal(assignment, clause_at(formula, learned_ref)->literals[0], learned_ref);
+        }
+    }
+
+    free(decisions.order);
+    free_assignment(assignment);
+    free_formula(formula);
+    return seconds * 1e6 / analyzed;
+}
+
+static double parse_sample(TextBuffer* text) {
+    double start = stats_clock();
+    Formula* formula = parse_text(text);
+    double seconds = stats_clock() - start;
+    free_formula(formula);
+    return text->size / seconds / 1e6;
+}
+
+// Preprocess and solve every file, like a plain run of the solver without
+// printing. The result must be the expected one. The "c" lines the solver
+// logs on stderr would bury the results, so stderr is closed meanwhile.
+static double solve_sample(char** files, int count, bool satisfiable) {
+    double seconds = 0;
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (saved_stderr >= 0 && null >= 0) {
+        dup2(null, STDERR_FILENO);
+    }
+    for (int i = 0; i < count; i++) {
+        Formula* formula = parse_cnf_file(files[i]);
+        if (!formula) {
+            fprintf(stderr, "Failed to parse the CNF file: %s\n", files[i]);
+            exit(EXIT_FAILURE);
+        }
+        ReconstructionStack eliminated = {NULL, 0, 0};
+        SolverOptions options = default_solver_options();
+        double start = stats_clock();
+        formula = preprocess_formula(formula, &eliminated, options.probe, NULL);
+        Assignment* assignment = create_assignment(formula->num_variables);
+        assignment->options = options;
+        bool result = solve(formula, assignment);
+        seconds += stats_clock() - start;
+        if (result != satisfiable) {
+            dup2(saved_stderr, STDERR_FILENO);
+            fprintf(stderr, "Wrong result on %s\n", files[i]);
+            exit(EXIT_FAILURE);
+        }
+        free_reconstruction(&eliminated);
+        free_assignment(assignment);
+        free_formula(formula);
+    }
+    if (saved_stderr >= 0 && null >= 0) {
+        dup2(saved_stderr, STDERR_FILENO);
+    }
+    if (saved_stderr >= 0) {
+        close(saved_stderr);
+    }
+    if (null >= 0) {
+        close(null);
+    }
+    return seconds * 1e3;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between the two closest sorted samples
+static double percentile(const double* sorted, int count, double p) {
+    double position = p * (count - 1);
+    int below = (int)position;
+    if (below + 1 >= count) {
+        return sorted[count - 1];
+    }
+    return sorted[below] + (position - below) * (sorted[below + 1] - sorted[below]);
+}
+
+// A field of the line of name in the baseline file, false if it is not there
+static bool baseline_field(const char* baseline, const char* name, const char* field, double* value) {
+    char key[128];
+    snprintf(key, sizeof key, "{\"name\": \"%s\",", name);
+    const char* line = baseline ? strstr(baseline, key) : NULL;
+    if (!line) {
+        return false;
+    }
+    snprintf(key, sizeof key, "\"%s\": ", field);
+    const char* end = strchr(line, '\n');
+    const char* found = strstr(line, key);
+    if (!found || (end && found > end)) {
+        return false;
+    }
+    *value = strtod(found + strlen(key), NULL);
+    return true;
+}
+
+// Relative change of the median against the baseline, false if the baseline
+// does not have the benchmark. It is a regression if the median is worse by
+// more than BENCH_TOLERANCE and outside the baseline's 10th to 90th
+// percentile range, so not just noise.
+static bool compare_baseline(const char* baseline, const char* name, bool higher_is_better, double median,
+                             double* change, bool* regression) {
+    double before, p10, p90;
+    if (!baseline_field(baseline, name, "median", &before) || before <= 0
+        || !baseline_field(baseline, name, "p10", &p10) || !baseline_field(baseline, name, "p90", &p90)) {
+        return false;
+    }
+    *change = (median - before) / before;
+    if (higher_is_better) {
+        *regression = -*change > BENCH_TOLERANCE && median < p10;
+    } else {
+        *regression = *change > BENCH_TOLERANCE && median > p90;
+    }
+    return true;
+}
+
+static void report(BenchRun* run, const char* name, const char* unit, bool higher_is_better, double* samples) {
+    int n = run->repeats;
+    qsort(samples, n, sizeof(double), compare_doubles);
+    double mean = 0, variance = 0;
+    for (int i = 0; i < n; i++) {
+        mean += samples[i];
+    }
+    mean /= n;
+    for (int i = 0; i < n; i++) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    variance = n > 1 ? variance / (n - 1) : 0;
+    double median = percentile(samples, n, 0.5);
+    double p10 = percentile(samples, n, 0.1), p90 = percentile(samples, n, 0.9);
+    double deviation = mean > 0 ? 100 * sqrt(variance) / mean : 0;
+
+    printf("%-28s %12.4g %-10s p10 %-10.4g p90 %-10.4g sd %5.1f%%", name, median, unit, p10, p90, deviation);
+    double change;
+    bool regression;
+    if (compare_baseline(run->baseline, name, higher_is_better, median, &change, &regression)) {
+        printf("  %+6.1f%%%s", 100 * change, regression ? "  REGRESSION" : "");
+        run->regressions += regression;
+    }
+    printf("\n");
+    fflush(stdout);
+
+    if (run->output) {
+        fprintf(run->output, "{\"name\": \"%s\", \"unit\": \"%s\", \"higher_is_better\": %s, \"seed\": %llu, "
+                "\"repeats\": %d, \"median\": %.6g, \"p10\": %.6g, \"p90\": %.6g, \"min\": %.6g, \"max\": %.6g, "
+                "\"mean\": %.6g, \"variance\": %.6g}\n",
+                name, unit, higher_is_better ? "true" : "false", (unsigned long long)BENCH_SEED, n, median,
+                p10, p90, samples[0], samples[n - 1], mean, variance);
+        fflush(run->output);
+    }
+}
+
+static void bench_propagation(BenchRun* run, const char* name, int num_vars, int num_clauses, int k, int descents) {
+    TextBuffer text = random_cnf(BENCH_SEED, num_vars, num_clauses, k);
+    double* samples = (double*)allocate_memory(run->repeats * sizeof(double), "benchmarks");
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        propagation_sample(&text, descents);
+    }
+    for (int i = 0; i < run->repeats; i++) {
+        samples[i] = propagation_sample(&text, descents);
+    }
+    report(run, name, "props/s", true, samples);
+    free(samples);
+    free(text.data);
+}
+
+static void bench_analysis(BenchRun* run, const char* name, int num_vars, int num_clauses, int conflicts) {
+    TextBuffer text = random_cnf(BENCH_SEED, num_vars, num_clauses, 3);
+    double* samples = (double*)allocate_memory(run->repeats * sizeof(double), "benchmarks");
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        analysis_sample(&text, conflicts);
+    }
+    for (int i = 0; i < run->repeats; i++) {
+        samples[i] = analysis_sample(&text, conflicts);
+    }
+    report(run, name, "us/conflict", false, samples);
+    free(samples);
+    free(text.data);
+}
+
+static void bench_parse(BenchRun* run, const char* name, int num_vars, int num_clauses) {
+    TextBuffer text = random_cnf(BENCH_SEED, num_vars, num_clauses, 3);
+    double* samples = (double*)allocate_memory(run->repeats * sizeof(double), "benchmarks");
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        parse_sample(&text);
+    }
+    for (int i = 0; i < run->repeats; i++) {
+        samples[i] = parse_sample(&text);
+    }
+    report(run, name, "MB/s", true, samples);
+    free(samples);
+    free(text.data);
+}
+
+// The instances pattern % 1 .. count, e.g. "examples/sat_100-430/uf100-0%d.cnf"
+static void bench_solve(BenchRun* run, const char* name, const char* pattern, int count, bool satisfiable) {
+    char** files = (char**)allocate_memory(count * sizeof(char*), "benchmarks");
+    for (int i = 0; i < count; i++) {
+        files[i] = (char*)allocate_memory(strlen(pattern) + 16, "benchmarks");
+        sprintf(files[i], pattern, i + 1);
+    }
+    double* samples = (double*)allocate_memory(run->repeats * sizeof(double), "benchmarks");
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        solve_sample(files, count, satisfiable);
+    }
+    for (int i = 0; i < run->repeats; i++) {
+        samples[i] = solve_sample(files, count, satisfiable);
+    }
+    report(run, name, "ms", false, samples);
+    free(samples);
+    for (int i = 0; i < count; i++) {
+        free(files[i]);
+    }
+    free(files);
+}
+
+static char* read_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open the baseline file");
+        return NULL;
+    }
+    TextBuffer text = {NULL, 0, 0};
+    char chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof chunk, file)) > 0) {
+        append_text(&text, chunk, length);
+    }
+    append_text(&text, "", 1);
+    fclose(file);
+    return text.data;
+}
+
+// Run every benchmark whose name contains filter (all if it is NULL).
+// Returns the number of regressions against the baseline, or -1 if a file
+// cannot be opened.
+int run_benchmarks(int repeats, const char* filter, const char* output, const char* baseline) {
+    BenchRun run = {NULL, NULL, repeats, 0};
+    if (output && !(run.output = fopen(output, "w"))) {
+        perror("Failed to open the benchmark output file");
+        return -1;
+    }
+    if (baseline && !(run.baseline = read_file(baseline))) {
+        if (run.output) {
+            fclose(run.output);
+        }
+        return -1;
+    }
+
+    printf("%-28s %12s %-10s (%d runs, seed %llu)\n", "benchmark", "median", "unit", repeats,
+           (unsigned long long)BENCH_SEED);
+#define BENCH(name, call) if (!filter || strstr(name, filter)) call
+    BENCH("propagate/3sat-n20000", bench_propagation(&run, "propagate/3sat-n20000", 20000, 84000, 3, 100));
+    BENCH("propagate/7sat-n2000", bench_propagation(&run, "propagate/7sat-n2000", 2000, 170000, 7, 40));
+    BENCH("analyze/3sat-n5000", bench_analysis(&run, "analyze/3sat-n5000", 5000, 21000, 5000));
+    BENCH("parse/3sat-n200000", bench_parse(&run, "parse/3sat-n200000", 200000, 840000));
+    BENCH("solve/uf100", bench_solve(&run, "solve/uf100", "examples/sat_100-430/uf100-0%d.cnf", 50, true));
+    BENCH("solve/uuf100", bench_solve(&run, "solve/uuf100", "examples/unsat_100-430/uuf100-0%d.cnf", 40, false));
+    BENCH("solve/cbs-b90", bench_solve(&run, "solve/cbs-b90",
+                                       "examples/CBS_k3_n100_m449_b90/CBS_k3_n100_m449_b90_%d.cnf", 50, true));
+#undef BENCH
+
+    if (run.output) {
+        fclose(run.output);
+    }
+    free(run.baseline);
+    return run.regressions;
+}
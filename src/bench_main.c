@@ -0,0 +1,36 @@
+#include "sat.h"
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  --repeat=<n>: timed runs of each benchmark (default: %d)\n", BENCH_REPEATS);
+    printf("  --filter=<text>: only the benchmarks whose name contains <text>\n");
+    printf("  --output=<file>: write the results to <file>, one JSON object per line\n");
+    printf("  --baseline=<file>: compare the medians with the results of an earlier run\n");
+}
+
+int main(int argc, char* argv[]) {
+    int repeats = BENCH_REPEATS;
+    const char* filter = NULL;
+    const char* output = NULL;
+    const char* baseline = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--repeat=", 9) == 0 && atoi(argv[i] + 9) > 0) {
+            repeats = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output = argv[i] + 9;
+        } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            baseline = argv[i] + 11;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    int regressions = run_benchmarks(repeats, filter, output, baseline);
+    if (regressions > 0) {
+        printf("%d regression%s against %s\n", regressions, regressions > 1 ? "s" : "", baseline);
+    }
+    return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
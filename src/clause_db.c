@@ -0,0 +1,135 @@
+#include "sat.h"
+
+// Learned clause database. Learned clauses live in the clause arena next to
+// the original ones and are listed in formula->learned.
+// reduce_learned_clauses() periodically deletes the worse half of them:
+// - core clauses (LBD <= CORE_LBD) are kept forever,
+// - tier-2 clauses (LBD <= TIER2_LBD) survive as long as they are used
+//   between two reductions,
+// - everything else competes on LBD first and activity second.
+// Clauses that are the antecedent of a current assignment are locked and
+// never deleted. Once enough of the arena is wasted it is compacted.
+
+// Store a learned clause (literals to watch first) and return its reference
+ClauseRef add_learned_clause(Formula* formula, const Lit* literals, int size, int lbd) {
+    if (formula->num_learned >= formula->learned_capacity) {
+        formula->learned_capacity = formula->learned_capacity ? formula->learned_capacity * 2 : 1024;
+        formula->learned = (ClauseRef*)realloc(formula->learned, formula->learned_capacity * sizeof(ClauseRef));
+        if (!formula->learned) {
+            perror("Failed to reallocate memory for learned clauses");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (formula->proof) {
+        proof_add(formula->proof, literals, size);
+    }
+    ClauseRef ref = arena_alloc_clause(&formula->arena, literals, size, true);
+    clause_at(formula, ref)->lbd = lbd;
+    formula->learned[formula->num_learned++] = ref;
+    if (formula->watches) {
+        attach_clause(formula, ref);
+    }
+    return ref;
+}
+
+void bump_clause_activity(Assignment* assignment, Formula* formula, StoredClause* clause) {
+    clause->activity += assignment->clause_activity_increment;
+    if (clause->activity > 1e20f) {
+        for (int i = 0; i < formula->num_learned; i++) {
+            clause_at(formula, formula->learned[i])->activity *= 1e-20f;
+        }
+        assignment->clause_activity_increment *= 1e-20f;
+    }
+}
+
+// A clause is locked while it is the reason for the assignment of its first
+// literal. Binary clauses are propagated from their watches without being
+// reordered, so either of their literals may be the implied one.
+bool clause_locked(Formula* formula, Assignment* assignment, ClauseRef ref) {
+    StoredClause* clause = clause_at(formula, ref);
+    for (int i = 0; i < (clause->size == 2 ? 2 : 1); i++) {
+        int var = lit_var(clause->literals[i]);
+        if (variable_assigned(assignment, var) && assignment->vars[var].reason == ref) {
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef struct {
+    ClauseRef ref;
+    int lbd;
+    float activity;
+} ReduceCandidate;
+
+// worst clauses first: high LBD, then low activity
+static int compare_candidates(const void* a, const void* b) {
+    const ReduceCandidate* x = (const ReduceCandidate*)a;
+    const ReduceCandidate* y = (const ReduceCandidate*)b;
+    if (x->lbd != y->lbd) {
+        return y->lbd - x->lbd;
+    }
+    if (x->activity != y->activity) {
+        return x->activity < y->activity ? -1 : 1;
+    }
+    return x->ref < y->ref ? -1 : (x->ref > y->ref);
+}
+
+// Delete the worse half of the reducible learned clauses. Must be called
+// when propagation is complete, so that every clause is watched by its
+// first two literals: only those watch lists lose the deleted clauses.
+void reduce_learned_clauses(Formula* formula, Assignment* assignment) {
+    int n = formula->num_learned;
+    ReduceCandidate* candidates = (ReduceCandidate*)malloc(n * sizeof(ReduceCandidate));
+    if (!candidates && n > 0) {
+        perror("Failed to allocate memory for clause reduction");
+        exit(EXIT_FAILURE);
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        ClauseRef ref = formula->learned[i];
+        StoredClause* clause = clause_at(formula, ref);
+        bool used = clause->used;
+        clause->used = false;
+        if (clause->lbd <= CORE_LBD || (clause->lbd <= TIER2_LBD && used)) {
+            continue;
+        }
+        if (clause_locked(formula, assignment, ref)) {
+            continue;
+        }
+        candidates[count].ref = ref;
+        candidates[count].lbd = clause->lbd;
+        candidates[count].activity = clause->activity;
+        count++;
+    }
+    qsort(candidates, count, sizeof(ReduceCandidate), compare_candidates);
+    ClauseRef* deleted = (ClauseRef*)malloc((count / 2 + 1) * sizeof(ClauseRef));
+    if (!deleted) {
+        perror("Failed to allocate memory for clause reduction");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count / 2; i++) {
+        delete_clause(formula, candidates[i].ref);
+        deleted[i] = candidates[i].ref;
+    }
+
+    // references stay valid, only the list of learned clauses is compacted
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (!clause_at(formula, formula->learned[i])->deleted) {
+            formula->learned[kept++] = formula->learned[i];
+        }
+    }
+    formula->num_learned = kept;
+
+    if (formula->arena.wasted > ARENA_GC_FRACTION * formula->arena.size) {
+        collect_garbage(formula, assignment);
+    } else {
+        detach_deleted_clauses(formula, deleted, count / 2);
+    }
+
+    assignment->reductions++;
+    free(deleted);
+    free(candidates);
+}
@@ -0,0 +1,416 @@
+#include "sat.h"
+#include <pthread.h>
+
+// Cube and conquer: a lookahead phase splits the formula into cubes, partial
+// assignments on the variables whose both values propagate the most, and a
+// pool of workers solves the formula under each cube as assumptions. The
+// cubes cover the whole search space, so the formula is unsatisfiable once
+// every cube is refuted, and satisfiable as soon as one cube is not.
+//
+// The split is a depth-first walk of the first cube_depth decisions. At each
+// node the LOOKAHEAD_CANDIDATES free variables occurring most (short clauses
+// weighted more) are probed both ways with unit_propagation; a literal whose
+// propagation fails is implied false and assigned on the spot, and the node
+// splits on the variable with the largest product of implied literals.
+//
+// Workers start with equal contiguous ranges of the cubes in walk order, so
+// neighbouring cubes (which share most of their literals) go to the same
+// worker and its learned clauses stay relevant. A worker whose range is empty
+// steals the back half of another worker's range.
+
+#define LOOKAHEAD_REFUTED -2 //the node has no solution
+#define LOOKAHEAD_COMPLETE -1 //every variable is assigned at the node
+
+typedef struct {
+    Lit* literals; //all cubes one after the other
+    int size;
+    int capacity;
+    int* start; //cube i is literals[start[i]] .. literals[start[i+1]-1]
+    int count;
+    int start_capacity;
+} CubeSet;
+
+typedef struct {
+    Formula* formula; //private copy, propagation reorders clause literals
+    Assignment* assignment;
+    int max_depth;
+    double* weight; //static score of each variable
+    int* candidates;
+    Lit* path; //decisions and implied literals from the root to the node
+    int path_size;
+    CubeSet* cubes;
+    int refuted; //nodes closed by lookahead
+} Lookahead;
+
+// Cubes not taken yet by their owner, the range [begin, end) of the cube set
+typedef struct {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+} CubeQueue;
+
+typedef struct CubeRun CubeRun;
+
+typedef struct {
+    int index;
+    CubeRun* run;
+    Formula* formula;
+    Assignment* assignment;
+    bool result;
+    int solved;
+    int stolen;
+} CubeWorker;
+
+struct CubeRun {
+    Formula* shared;
+    SolverOptions* options;
+    CubeSet* cubes;
+    CubeQueue* queues;
+    CubeWorker* workers;
+    int count;
+    atomic_int stop;
+    atomic_int winner; //worker that found a model or refuted the formula, -1 if none
+    ClauseExchange* exchange;
+};
+
+static void add_cube(CubeSet* cubes, const Lit* literals, int size) {
+    if (cubes->count + 2 > cubes->start_capacity) {
+        cubes->start_capacity = cubes->start_capacity ? cubes->start_capacity * 2 : 64;
+        cubes->start = (int*)realloc(cubes->start, cubes->start_capacity * sizeof(int));
+        if (!cubes->start) {
+            perror("Failed to reallocate memory for cubes");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (cubes->size + size >= cubes->capacity) {
+        while (cubes->size + size >= cubes->capacity) {
+            cubes->capacity = cubes->capacity ? cubes->capacity * 2 : 256;
+        }
+        cubes->literals = (Lit*)realloc(cubes->literals, cubes->capacity * sizeof(Lit));
+        if (!cubes->literals) {
+            perror("Failed to reallocate memory for cube literals");
+            exit(EXIT_FAILURE);
+        }
+    }
+    cubes->start[cubes->count] = cubes->size;
+    memcpy(cubes->literals + cubes->size, literals, size * sizeof(Lit));
+    cubes->size += size;
+    cubes->count++;
+    cubes->start[cubes->count] = cubes->size;
+}
+
+// Literals implied by lit at the current node, or -1 if propagating it fails
+static int probe(Lookahead* lookahead, Lit lit) {
+    Assignment* assignment = lookahead->assignment;
+    ClauseRef conflict;
+    int before = assignment->trail_size;
+    new_decision_level(assignment);
+    assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+    int status = unit_propagation(lookahead->formula, assignment, &conflict);
+    int implied = assignment->trail_size - before;
+    backtrack_assignment(assignment, assignment->current_depth_level - 1);
+    return status == UIP_CONFLICT ? -1 : implied;
+}
+
+// The free variables with the highest weight, best first. Returns how many.
+static int select_candidates(Lookahead* lookahead) {
+    Assignment* assignment = lookahead->assignment;
+    int* candidates = lookahead->candidates;
+    int count = 0;
+    for (int var = 0; var < assignment->size; var++) {
+        if (variable_assigned(assignment, var)) {
+            continue;
+        }
+        if (count == LOOKAHEAD_CANDIDATES && lookahead->weight[var] <= lookahead->weight[candidates[count - 1]]) {
+            continue;
+        }
+        int i = count < LOOKAHEAD_CANDIDATES ? count++ : count - 1;
+        while (i > 0 && lookahead->weight[candidates[i - 1]] < lookahead->weight[var]) {
+            candidates[i] = candidates[i - 1];
+            i--;
+        }
+        candidates[i] = var;
+    }
+    return count;
+}
+
+// Assign a literal implied at the current node and propagate it
+static bool assign_implied(Lookahead* lookahead, Lit lit) {
+    ClauseRef conflict;
+    assign_literal(lookahead->assignment, lit, ANTECEDENT_CLAUSE_NONE);
+    lookahead->path[lookahead->path_size++] = lit;
+    return unit_propagation(lookahead->formula, lookahead->assignment, &conflict) != UIP_CONFLICT;
+}
+
+// Variable to split the current node on, LOOKAHEAD_COMPLETE or LOOKAHEAD_REFUTED
+static int choose_split(Lookahead* lookahead) {
+    Assignment* assignment = lookahead->assignment;
+    int count = select_candidates(lookahead);
+    int best = LOOKAHEAD_COMPLETE;
+    double best_score = -1;
+    for (int i = 0; i < count; i++) {
+        int var = lookahead->candidates[i];
+        if (variable_assigned(assignment, var)) {
+            continue; //implied by a failed literal found earlier
+        }
+        int positive = probe(lookahead, make_lit(var, false));
+        int negative = probe(lookahead, make_lit(var, true));
+        if (positive < 0 && negative < 0) {
+            return LOOKAHEAD_REFUTED;
+        }
+        if (positive < 0 || negative < 0) {
+            if (!assign_implied(lookahead, make_lit(var, positive < 0))) {
+                return LOOKAHEAD_REFUTED;
+            }
+            continue;
+        }
+        double score = (positive + 1.0) * (negative + 1.0);
+        if (score > best_score) {
+            best_score = score;
+            best = var;
+        }
+    }
+    if (best == LOOKAHEAD_COMPLETE) {
+        // every candidate got implied, fall back on any free variable
+        for (int var = 0; var < assignment->size; var++) {
+            if (!variable_assigned(assignment, var)) {
+                return var;
+            }
+        }
+    }
+    return best;
+}
+
+static void split(Lookahead* lookahead, int depth) {
+    Assignment* assignment = lookahead->assignment;
+    int var = depth < lookahead->max_depth ? choose_split(lookahead) : LOOKAHEAD_COMPLETE;
+    if (var == LOOKAHEAD_REFUTED) {
+        lookahead->refuted++;
+        return;
+    }
+    if (var == LOOKAHEAD_COMPLETE || assignment->trail_size == assignment->size) {
+        add_cube(lookahead->cubes, lookahead->path, lookahead->path_size);
+        return;
+    }
+    int path_size = lookahead->path_size;
+    for (int negated = 0; negated <= 1; negated++) {
+        ClauseRef conflict;
+        Lit lit = make_lit(var, negated);
+        new_decision_level(assignment);
+        assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+        lookahead->path[lookahead->path_size++] = lit;
+        if (unit_propagation(lookahead->formula, assignment, &conflict) == UIP_CONFLICT) {
+            lookahead->refuted++;
+        } else {
+            split(lookahead, depth + 1);
+        }
+        lookahead->path_size = path_size;
+        backtrack_assignment(assignment, assignment->current_depth_level - 1);
+    }
+}
+
+// Split formula into cubes. Returns false if lookahead refutes the formula
+// at the root; cubes is then empty.
+static bool generate_cubes(Formula* formula, int max_depth, CubeSet* cubes, int* refuted) {
+    Lookahead lookahead;
+    lookahead.formula = copy_formula(formula);
+    lookahead.assignment = create_assignment(formula->num_variables);
+    lookahead.max_depth = max_depth;
+    lookahead.weight = (double*)calloc(formula->num_variables, sizeof(double));
+    lookahead.candidates = (int*)malloc(LOOKAHEAD_CANDIDATES * sizeof(int));
+    lookahead.path = (Lit*)malloc((formula->num_variables + 1) * sizeof(Lit));
+    if (!lookahead.weight || !lookahead.candidates || !lookahead.path) {
+        perror("Failed to allocate memory for lookahead");
+        exit(EXIT_FAILURE);
+    }
+    lookahead.path_size = 0;
+    lookahead.cubes = cubes;
+    lookahead.refuted = 0;
+
+    // a clause of size k counts 2^(2-k) for each of its variables
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        int shift = clause->size < 2 ? 0 : (clause->size > 32 ? 30 : clause->size - 2);
+        double weight = 1.0 / (1u << shift);
+        for (int j = 0; j < (int)clause->size; j++) {
+            lookahead.weight[lit_var(clause->literals[j])] += weight;
+        }
+    }
+
+    bool satisfiable = false;
+    ClauseRef conflict;
+    init_watches(lookahead.formula);
+    if (assign_unit_clauses(lookahead.formula, lookahead.assignment)
+        && unit_propagation(lookahead.formula, lookahead.assignment, &conflict) != UIP_CONFLICT) {
+        split(&lookahead, 0);
+        satisfiable = cubes->count > 0;
+    }
+    *refuted = lookahead.refuted;
+
+    free(lookahead.weight);
+    free(lookahead.candidates);
+    free(lookahead.path);
+    free_assignment(lookahead.assignment);
+    free_formula(lookahead.formula);
+    return satisfiable;
+}
+
+// Next cube for worker index, stolen from another worker if its own range
+// is empty. Returns -1 once every cube has been taken.
+static int next_cube(CubeRun* run, int index) {
+    CubeQueue* own = &run->queues[index];
+    pthread_mutex_lock(&own->lock);
+    if (own->begin < own->end) {
+        int cube = own->begin++;
+        pthread_mutex_unlock(&own->lock);
+        return cube;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    for (int i = 1; i < run->count; i++) {
+        CubeQueue* victim = &run->queues[(index + i) % run->count];
+        pthread_mutex_lock(&victim->lock);
+        int take = (victim->end - victim->begin + 1) / 2;
+        if (take == 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        victim->end -= take;
+        int first = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+
+        pthread_mutex_lock(&own->lock);
+        own->begin = first + 1;
+        own->end = first + take;
+        pthread_mutex_unlock(&own->lock);
+        run->workers[index].stolen += take;
+        return first;
+    }
+    return -1;
+}
+
+static void* cube_worker(void* argument) {
+    CubeWorker* worker = (CubeWorker*)argument;
+    CubeRun* run = worker->run;
+    worker->formula = copy_formula(run->shared);
+    worker->assignment = create_assignment(worker->formula->num_variables);
+    worker->assignment->options = *run->options;
+    worker->assignment->options.seed = run->options->seed + 0x9E3779B97F4A7C15ULL * worker->index;
+    worker->assignment->stop = &run->stop;
+    if (run->exchange) {
+        join_exchange(worker->assignment, run->exchange, worker->index);
+    }
+
+    int cube;
+    while (!atomic_load(&run->stop) && (cube = next_cube(run, worker->index)) >= 0) {
+        CubeSet* cubes = run->cubes;
+        worker->result = solve_assuming(worker->formula, worker->assignment, cubes->literals + cubes->start[cube],
+                                        cubes->start[cube + 1] - cubes->start[cube]);
+        if (worker->assignment->interrupted) {
+            break;
+        }
+        worker->solved++;
+        // a model, or a refutation that does not depend on the cube, ends the run
+        if (worker->result || !worker->assignment->assumption_failed) {
+            int searching = -1;
+            if (atomic_compare_exchange_strong(&run->winner, &searching, worker->index)) {
+                atomic_store(&run->stop, 1);
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Solve formula by cube and conquer with options->cube_depth and
+// options->threads workers. Returns an assignment to be freed by the caller,
+// holding the model if *result is true. counters, if not NULL, receives the
+// lookahead, work stealing and clause sharing totals.
+Assignment* solve_cubes(Formula* formula, SolverOptions* options, bool* result, PhaseCounters* counters) {
+    CubeSet cubes = {NULL, 0, 0, NULL, 0, 0};
+    int refuted;
+    double start = stats_clock();
+    bool open = generate_cubes(formula, options->cube_depth, &cubes, &refuted);
+    if (counters) {
+        counters->cubes = cubes.count;
+        counters->refuted_branches = refuted;
+        counters->lookahead_seconds = stats_clock() - start;
+    }
+    if (!open) {
+        free(cubes.literals);
+        free(cubes.start);
+        *result = false;
+        return create_assignment(formula->num_variables);
+    }
+
+    CubeRun run;
+    run.shared = formula;
+    run.options = options;
+    run.cubes = &cubes;
+    run.count = options->threads < cubes.count ? options->threads : cubes.count;
+    run.queues = (CubeQueue*)malloc(run.count * sizeof(CubeQueue));
+    run.workers = (CubeWorker*)calloc(run.count, sizeof(CubeWorker));
+    pthread_t* handles = (pthread_t*)malloc(run.count * sizeof(pthread_t));
+    if (!run.queues || !run.workers || !handles) {
+        perror("Failed to allocate memory for cube workers");
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&run.stop, 0);
+    atomic_init(&run.winner, -1);
+    run.exchange = options->share && run.count > 1 ? create_exchange(run.count) : NULL;
+
+    for (int i = 0; i < run.count; i++) {
+        pthread_mutex_init(&run.queues[i].lock, NULL);
+        run.queues[i].begin = (int)((long long)cubes.count * i / run.count);
+        run.queues[i].end = (int)((long long)cubes.count * (i + 1) / run.count);
+        run.workers[i].index = i;
+        run.workers[i].run = &run;
+    }
+    for (int i = 0; i < run.count; i++) {
+        if (pthread_create(&handles[i], NULL, cube_worker, &run.workers[i]) != 0) {
+            perror("Failed to create cube worker");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < run.count; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    if (counters) {
+        counters->threads = run.count;
+        counters->shared = run.exchange != NULL;
+    }
+    for (int i = 0; i < run.count; i++) {
+        Assignment* a = run.workers[i].assignment;
+        if (options->stats == STATS_TEXT) {
+            fprintf(stderr, "c worker %d: %d cubes solved, %d stolen, %lld conflicts\n",
+                    i, run.workers[i].solved, run.workers[i].stolen, a->conflicts);
+        }
+        if (counters) {
+            counters->cubes_stolen += run.workers[i].stolen;
+            counters->exported += a->shared_exported;
+            counters->imported += a->shared_imported;
+            counters->used += a->shared_used;
+            counters->dropped += a->shared_dropped;
+        }
+    }
+
+    // without a winner every cube was refuted
+    int winner = atomic_load(&run.winner);
+    int kept = winner >= 0 ? winner : 0;
+    *result = winner >= 0 && run.workers[winner].result;
+    Assignment* assignment = run.workers[kept].assignment;
+    for (int i = 0; i < run.count; i++) {
+        if (i != kept) {
+            free_assignment(run.workers[i].assignment);
+        }
+        free_formula(run.workers[i].formula);
+        pthread_mutex_destroy(&run.queues[i].lock);
+    }
+    free_exchange(run.exchange);
+    free(run.queues);
+    free(run.workers);
+    free(handles);
+    free(cubes.literals);
+    free(cubes.start);
+    return assignment;
+}
@@ -2,6 +2,17 @@
 
 #define INITIAL_CAPACITY 32
 
+// malloc that exits with a message naming what was being allocated, for
+// the modules that build many arrays at once
+void* allocate_memory(size_t size, const char* what) {
+    void* array = malloc(size ? size : 1);
+    if (!array) {
+        fprintf(stderr, "Failed to allocate memory for %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
 Formula* create_formula() {
     Formula* formula = (Formula*)malloc(sizeof(Formula));
     if (!formula) {
@@ -9,16 +20,23 @@ Formula* create_formula() {
         exit(EXIT_FAILURE);
     }
     
-    formula->clauses = (Clause*)malloc(INITIAL_CAPACITY * sizeof(Clause));
+    formula->clauses = (ClauseRef*)malloc(INITIAL_CAPACITY * sizeof(ClauseRef));
     if (!formula->clauses) {
         perror("Failed to allocate memory for clauses");
         free(formula);
         exit(EXIT_FAILURE);
     }
     
+    init_arena(&formula->arena);
     formula->size = 0;
     formula->capacity = INITIAL_CAPACITY;
+    formula->learned = NULL;
+    formula->num_learned = 0;
+    formula->learned_capacity = 0;
     formula->num_variables = 0;
+    formula->watches = NULL;
+    formula->watched_variables = 0;
+    formula->proof = NULL;
     
     return formula;
 }
@@ -26,34 +44,99 @@ Formula* create_formula() {
 void free_formula(Formula* formula) {
     if (!formula) return;
     
-    for (int i = 0; i < formula->size; i++) {
-        free_clause(&formula->clauses[i]);
-    }
-    
     free(formula->clauses);
+    free(formula->learned);
+    free_arena(&formula->arena);
+    free_watches(formula);
     free(formula);
 }
 
-void add_clause(Formula* formula, Clause* clause) {
+// Copy of the original clauses of a formula, without learned clauses or watches
+Formula* copy_formula(Formula* formula) {
+    Formula* copy = create_formula();
+    free(copy->clauses);
+    free_arena(&copy->arena);
+
+    copy->clauses = (ClauseRef*)malloc(formula->capacity * sizeof(ClauseRef));
+    copy->arena.memory = (uint32_t*)malloc(formula->arena.capacity * sizeof(uint32_t));
+    if (!copy->clauses || !copy->arena.memory) {
+        perror("Failed to allocate memory for formula copy");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy->clauses, formula->clauses, formula->size * sizeof(ClauseRef));
+    memcpy(copy->arena.memory, formula->arena.memory, formula->arena.size * sizeof(uint32_t));
+    copy->arena.size = formula->arena.size;
+    copy->arena.capacity = formula->arena.capacity;
+    copy->arena.wasted = formula->arena.wasted;
+    copy->size = formula->size;
+    copy->capacity = formula->capacity;
+    copy->num_variables = formula->num_variables;
+    return copy;
+}
+
+static void empty_watches(Formula* formula) {
+    for (int i = 0; i < 2 * formula->watched_variables; i++) {
+        formula->watches[i].num_binaries = 0;
+        formula->watches[i].num_ternaries = 0;
+        formula->watches[i].size = 0;
+    }
+}
+
+// Remove every clause and variable but keep the memory, so the formula can
+// be filled with the next instance. The watch lists stay allocated (and
+// empty): clauses added from now on are watched as they are added.
+void clear_formula(Formula* formula) {
+    formula->arena.size = 0;
+    formula->arena.wasted = 0;
+    formula->size = 0;
+    formula->num_learned = 0;
+    formula->num_variables = 0;
+    empty_watches(formula);
+}
+
+// Store an original clause (already in the internal encoding) in the arena
+ClauseRef add_original_clause(Formula* formula, const Lit* literals, int size) {
     if (formula->size >= formula->capacity) {
         formula->capacity *= 2;
-        formula->clauses = (Clause*)realloc(formula->clauses, formula->capacity * sizeof(Clause));
+        formula->clauses = (ClauseRef*)realloc(formula->clauses, formula->capacity * sizeof(ClauseRef));
         if (!formula->clauses) {
             perror("Failed to reallocate memory for clauses");
             exit(EXIT_FAILURE);
         }
     }
     
-    formula->clauses[formula->size] = *clause;
+    ClauseRef ref = arena_alloc_clause(&formula->arena, literals, size, false);
+    formula->clauses[formula->size] = ref;
     formula->size++;
     
     // Update the number of variables if needed
-    for (int i = 0; i < clause->size; i++) {
-        int var = abs(clause->literals[i]);
+    for (int i = 0; i < size; i++) {
+        int var = lit_var(literals[i]) + 1;
         if (var > formula->num_variables) {
             formula->num_variables = var;
         }
     }
+
+    // once the solver is running, new clauses are watched right away.
+    // The caller is responsible for putting the two literals to watch first.
+    if (formula->watches) {
+        attach_clause(formula, ref);
+    }
+    return ref;
+}
+
+// Add a clause built with create_clause/add_literal. The formula keeps its own
+// copy and takes ownership of the literal buffer, which is freed here.
+void add_clause(Formula* formula, Clause* clause) {
+    Lit* literals = (Lit*)clause->literals;
+    for (int i = 0; i < clause->size; i++) {
+        literals[i] = dimacs_to_lit(clause->literals[i]);
+    }
+    add_original_clause(formula, literals, clause->size);
+    free(clause->literals);
+    clause->literals = NULL;
+    clause->size = 0;
+    clause->capacity = 0;
 }
 
 Clause* create_clause() {
@@ -96,26 +179,164 @@ void free_clause(Clause* clause) {
     // Note: We don't free the clause itself because it's part of the formula array
 } 
 
-//sorts descending
-int comp(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
+static void grow_watches(Formula* formula) {
+    if (formula->num_variables <= formula->watched_variables) {
+        return;
+    }
+    formula->watches = (WatchList*)realloc(formula->watches, 2 * formula->num_variables * sizeof(WatchList));
+    if (!formula->watches) {
+        perror("Failed to allocate memory for watch lists");
+        exit(EXIT_FAILURE);
+    }
+    memset(&formula->watches[2 * formula->watched_variables], 0,
+           2 * (formula->num_variables - formula->watched_variables) * sizeof(WatchList));
+    formula->watched_variables = formula->num_variables;
 }
 
-int getSecondLargest(int* array, int n) {
-    
-    // Sort the array in non-decreasing order
-    qsort(array, n, sizeof(int), comp);
-  
-    // start from second last element as last element is the largest
-    for (int i = n - 2; i >= 0; i--) {
-        
-        // return the first element which is not equal to the 
-        // largest element
-        if (array[i] != array[n - 1]) {
-            return array[i];
+void add_watch(WatchList* watch_list, ClauseRef ref) {
+    if (watch_list->size >= watch_list->capacity) {
+        watch_list->capacity = watch_list->capacity ? watch_list->capacity * 2 : 4;
+        watch_list->clauses = (ClauseRef*)realloc(watch_list->clauses, watch_list->capacity * sizeof(ClauseRef));
+        if (!watch_list->clauses) {
+            perror("Failed to reallocate memory for watch list");
+            exit(EXIT_FAILURE);
         }
     }
-  
-    // If no second largest element was found, return the largest element
-    return array[n-1];
-}
\ No newline at end of file
+    watch_list->clauses[watch_list->size++] = ref;
+}
+
+static void add_binary_watch(WatchList* watch_list, Lit implied, ClauseRef ref) {
+    if (watch_list->num_binaries >= watch_list->binary_capacity) {
+        watch_list->binary_capacity = watch_list->binary_capacity ? watch_list->binary_capacity * 2 : 4;
+        watch_list->binaries = (BinaryWatch*)realloc(watch_list->binaries, watch_list->binary_capacity * sizeof(BinaryWatch));
+        if (!watch_list->binaries) {
+            perror("Failed to reallocate memory for binary watch list");
+            exit(EXIT_FAILURE);
+        }
+    }
+    watch_list->binaries[watch_list->num_binaries].implied = implied;
+    watch_list->binaries[watch_list->num_binaries].clause = ref;
+    watch_list->num_binaries++;
+}
+
+void add_ternary_watch(WatchList* watch_list, Lit first, Lit second, ClauseRef ref) {
+    if (watch_list->num_ternaries >= watch_list->ternary_capacity) {
+        watch_list->ternary_capacity = watch_list->ternary_capacity ? watch_list->ternary_capacity * 2 : 4;
+        watch_list->ternaries = (TernaryWatch*)realloc(watch_list->ternaries, watch_list->ternary_capacity * sizeof(TernaryWatch));
+        if (!watch_list->ternaries) {
+            perror("Failed to reallocate memory for ternary watch list");
+            exit(EXIT_FAILURE);
+        }
+    }
+    TernaryWatch* watch = &watch_list->ternaries[watch_list->num_ternaries++];
+    watch->other[0] = first;
+    watch->other[1] = second;
+    watch->clause = ref;
+}
+
+// Watch the first two literals of a clause, keeping the other literal of a
+// binary clause and the other two of a ternary one inline. Unit clauses
+// are not watched, the solver assigns them before the search starts.
+void attach_clause(Formula* formula, ClauseRef ref) {
+    StoredClause* clause = clause_at(formula, ref);
+    Lit* literals = clause->literals;
+    if (clause->size < 2) {
+        return;
+    }
+    grow_watches(formula);
+    if (clause->size == 2) {
+        add_binary_watch(&formula->watches[literals[0]], literals[1], ref);
+        add_binary_watch(&formula->watches[literals[1]], literals[0], ref);
+    } else if (clause->size == 3) {
+        add_ternary_watch(&formula->watches[literals[0]], literals[1], literals[2], ref);
+        add_ternary_watch(&formula->watches[literals[1]], literals[0], literals[2], ref);
+    } else {
+        add_watch(&formula->watches[literals[0]], ref);
+        add_watch(&formula->watches[literals[1]], ref);
+    }
+}
+
+// Build the watch lists for every clause currently in the formula. Once
+// they exist, only make room for variables added since.
+void init_watches(Formula* formula) {
+    if (formula->watches) {
+        grow_watches(formula);
+        return;
+    }
+    grow_watches(formula);
+    for (int i = 0; i < formula->size; i++) {
+        attach_clause(formula, formula->clauses[i]);
+    }
+}
+
+// Empty every watch list and watch all clauses again from their first two literals
+void rebuild_watches(Formula* formula) {
+    empty_watches(formula);
+    for (int i = 0; i < formula->size; i++) {
+        attach_clause(formula, formula->clauses[i]);
+    }
+    for (int i = 0; i < formula->num_learned; i++) {
+        attach_clause(formula, formula->learned[i]);
+    }
+}
+
+// Remove the watches of deleted clauses, visiting only the watch lists of
+// their first two literals, which are the ones watching them
+void detach_deleted_clauses(Formula* formula, const ClauseRef* refs, int count) {
+    int num_lits = 2 * formula->watched_variables;
+    bool* touched = (bool*)calloc(num_lits, sizeof(bool));
+    Lit* lits = (Lit*)malloc((2 * count + 1) * sizeof(Lit));
+    if (!touched || !lits) {
+        perror("Failed to allocate memory for detaching clauses");
+        exit(EXIT_FAILURE);
+    }
+    int num_touched = 0;
+    for (int i = 0; i < count; i++) {
+        StoredClause* clause = clause_at(formula, refs[i]);
+        for (int k = 0; k < 2 && k < (int)clause->size; k++) {
+            Lit lit = clause->literals[k];
+            if (!touched[lit]) {
+                touched[lit] = true;
+                lits[num_touched++] = lit;
+            }
+        }
+    }
+    for (int i = 0; i < num_touched; i++) {
+        WatchList* list = &formula->watches[lits[i]];
+        int kept = 0;
+        for (int b = 0; b < list->num_binaries; b++) {
+            if (!clause_at(formula, list->binaries[b].clause)->deleted) {
+                list->binaries[kept++] = list->binaries[b];
+            }
+        }
+        list->num_binaries = kept;
+        kept = 0;
+        for (int t = 0; t < list->num_ternaries; t++) {
+            if (!clause_at(formula, list->ternaries[t].clause)->deleted) {
+                list->ternaries[kept++] = list->ternaries[t];
+            }
+        }
+        list->num_ternaries = kept;
+        kept = 0;
+        for (int c = 0; c < list->size; c++) {
+            if (!clause_at(formula, list->clauses[c])->deleted) {
+                list->clauses[kept++] = list->clauses[c];
+            }
+        }
+        list->size = kept;
+    }
+    free(touched);
+    free(lits);
+}
+
+void free_watches(Formula* formula) {
+    if (!formula->watches) return;
+    for (int i = 0; i < 2 * formula->watched_variables; i++) {
+        free(formula->watches[i].binaries);
+        free(formula->watches[i].ternaries);
+        free(formula->watches[i].clauses);
+    }
+    free(formula->watches);
+    formula->watches = NULL;
+    formula->watched_variables = 0;
+}
@@ -0,0 +1,118 @@
+#include "sat.h"
+
+// Indexed binary max-heap of variables (0-based indices) keyed by activity.
+// position[] lets us find a variable in the heap in O(1), so bumping the
+// activity of a variable only needs a percolate-up from where it sits.
+
+static bool heap_before(VariableHeap* heap, int var_a, int var_b) {
+    return heap->activity[var_a] > heap->activity[var_b];
+}
+
+static void heap_percolate_up(VariableHeap* heap, int pos) {
+    int var = heap->heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!heap_before(heap, var, heap->heap[parent])) {
+            break;
+        }
+        heap->heap[pos] = heap->heap[parent];
+        heap->position[heap->heap[pos]] = pos;
+        pos = parent;
+    }
+    heap->heap[pos] = var;
+    heap->position[var] = pos;
+}
+
+static void heap_percolate_down(VariableHeap* heap, int pos) {
+    int var = heap->heap[pos];
+    while (2 * pos + 1 < heap->size) {
+        int child = 2 * pos + 1;
+        if (child + 1 < heap->size && heap_before(heap, heap->heap[child + 1], heap->heap[child])) {
+            child++;
+        }
+        if (!heap_before(heap, heap->heap[child], var)) {
+            break;
+        }
+        heap->heap[pos] = heap->heap[child];
+        heap->position[heap->heap[pos]] = pos;
+        pos = child;
+    }
+    heap->heap[pos] = var;
+    heap->position[var] = pos;
+}
+
+void init_heap(VariableHeap* heap, int num_variables, double* activity) {
+    heap->heap = (int*)malloc(num_variables * sizeof(int));
+    heap->position = (int*)malloc(num_variables * sizeof(int));
+    if ((!heap->heap || !heap->position) && num_variables > 0) {
+        perror("Failed to allocate memory for variable heap");
+        exit(EXIT_FAILURE);
+    }
+    heap->activity = activity;
+    clear_heap(heap, num_variables);
+}
+
+// Empty the heap, num_variables must not exceed the size it was created with
+void clear_heap(VariableHeap* heap, int num_variables) {
+    heap->size = 0;
+    for (int i = 0; i < num_variables; i++) {
+        heap->position[i] = -1;
+    }
+}
+
+// Make room for variables old_size..num_variables-1, outside the heap.
+// activity is the (possibly moved) activity array of the assignment.
+void grow_heap(VariableHeap* heap, int old_size, int num_variables, double* activity) {
+    heap->heap = (int*)realloc(heap->heap, num_variables * sizeof(int));
+    heap->position = (int*)realloc(heap->position, num_variables * sizeof(int));
+    if (!heap->heap || !heap->position) {
+        perror("Failed to reallocate memory for variable heap");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = old_size; i < num_variables; i++) {
+        heap->position[i] = -1;
+    }
+    heap->activity = activity;
+}
+
+void free_heap(VariableHeap* heap) {
+    free(heap->heap);
+    free(heap->position);
+}
+
+bool heap_contains(VariableHeap* heap, int var) {
+    return heap->position[var] >= 0;
+}
+
+void heap_insert(VariableHeap* heap, int var) {
+    if (heap_contains(heap, var)) {
+        return;
+    }
+    heap->heap[heap->size] = var;
+    heap->position[var] = heap->size;
+    heap->size++;
+    heap_percolate_up(heap, heap->size - 1);
+}
+
+// Restore the heap order after the activity of var increased
+void heap_increase(VariableHeap* heap, int var) {
+    if (heap_contains(heap, var)) {
+        heap_percolate_up(heap, heap->position[var]);
+    }
+}
+
+// Remove and return the variable with the highest activity, -1 if empty
+int heap_pop_max(VariableHeap* heap) {
+    if (heap->size == 0) {
+        return -1;
+    }
+    int top = heap->heap[0];
+    heap->position[top] = -1;
+    heap->size--;
+    if (heap->size > 0) {
+        heap->heap[0] = heap->heap[heap->size];
+        heap->position[heap->heap[0]] = 0;
+        heap_percolate_down(heap, 0);
+    }
+    return top;
+}
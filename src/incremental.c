@@ -0,0 +1,171 @@
+#include "sat.h"
+
+// Incremental solving: a SatSolver keeps one formula and one assignment for
+// a chain of related queries. Clauses can be added between calls and every
+// call may assume a few literals; learned clauses, variable activities and
+// saved phases carry over from one call to the next, since none of them
+// depends on the assumptions.
+// Literals are in DIMACS form (1-based, negative for complemented) and
+// variables are created by the first clause or assumption that uses them.
+// The model of a satisfiable call can be read until the next call that
+// changes the solver (solver_add_clause or solver_solve).
+
+static void reserve_buffer(SatSolver* solver, int size) {
+    if (size <= solver->buffer_capacity) {
+        return;
+    }
+    solver->buffer_capacity = size > 2 * solver->buffer_capacity ? size : 2 * solver->buffer_capacity;
+    solver->buffer = (Lit*)realloc(solver->buffer, solver->buffer_capacity * sizeof(Lit));
+    if (!solver->buffer) {
+        perror("Failed to reallocate memory for solver literals");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Make variables 1..num_variables known to the formula and the assignment
+static void reserve_variables(SatSolver* solver, const Literal* literals, int size) {
+    int num_variables = solver->formula->num_variables;
+    for (int i = 0; i < size; i++) {
+        if (abs(literals[i]) > num_variables) {
+            num_variables = abs(literals[i]);
+        }
+    }
+    solver->formula->num_variables = num_variables;
+    grow_assignment(solver->assignment, num_variables);
+}
+
+// Solver for formula, which it takes ownership of
+SatSolver* create_solver_for(Formula* formula) {
+    SatSolver* solver = (SatSolver*)malloc(sizeof(SatSolver));
+    if (!solver) {
+        perror("Failed to allocate memory for solver");
+        exit(EXIT_FAILURE);
+    }
+    solver->formula = formula;
+    solver->assignment = create_assignment(formula->num_variables);
+    solver->unsatisfiable = false;
+    solver->buffer = NULL;
+    solver->buffer_capacity = 0;
+    solver->core = NULL;
+    solver->core_size = 0;
+    return solver;
+}
+
+SatSolver* create_solver() {
+    return create_solver_for(create_formula());
+}
+
+void free_solver(SatSolver* solver) {
+    if (!solver) return;
+    free_assignment(solver->assignment);
+    free_formula(solver->formula);
+    free(solver->buffer);
+    free(solver->core);
+    free(solver);
+}
+
+// Search parameters for the following calls
+void solver_set_options(SatSolver* solver, const SolverOptions* options) {
+    solver->assignment->options = *options;
+    solver->assignment->options.threads = 1;
+}
+
+// Add a clause of non-zero literals. The clause is simplified by the
+// assignments at level 0: it is dropped if one of its literals is true
+// there and loses the literals that are false. Returns false once the
+// clauses are unsatisfiable.
+bool solver_add_clause(SatSolver* solver, const Literal* literals, int size) {
+    if (solver->unsatisfiable) {
+        return false;
+    }
+    Assignment* assignment = solver->assignment;
+    reserve_variables(solver, literals, size);
+    reserve_buffer(solver, size);
+    // only level 0 assignments stay valid when a clause is added
+    backtrack_assignment(assignment, 0);
+
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        Lit lit = dimacs_to_lit(literals[i]);
+        int value = literal_value(assignment, lit);
+        if (value == LITERAL_TRUE) {
+            return true;
+        }
+        if (value == LITERAL_FALSE) {
+            continue;
+        }
+        bool duplicate = false;
+        for (int j = 0; j < kept; j++) {
+            if (solver->buffer[j] == lit_negate(lit)) {
+                return true; //tautology
+            }
+            duplicate |= solver->buffer[j] == lit;
+        }
+        if (!duplicate) {
+            solver->buffer[kept++] = lit;
+        }
+    }
+
+    if (kept == 0) {
+        solver->unsatisfiable = true;
+        return false;
+    }
+    if (kept == 1) {
+        // propagated at the start of the next call
+        assign_literal(assignment, solver->buffer[0], ANTECEDENT_CLAUSE_NONE);
+        return true;
+    }
+    add_original_clause(solver->formula, solver->buffer, kept);
+    return true;
+}
+
+// Solve the clauses added so far under the given assumptions (may be none).
+// Returns true if they have a model in which every assumption holds. If not,
+// solver_core() tells which assumptions were refuted; it is empty when the
+// clauses are unsatisfiable on their own.
+bool solver_solve(SatSolver* solver, const Literal* assumptions, int size) {
+    solver->core_size = 0;
+    if (solver->unsatisfiable) {
+        return false;
+    }
+    Assignment* assignment = solver->assignment;
+    reserve_variables(solver, assumptions, size);
+    reserve_buffer(solver, size);
+    for (int i = 0; i < size; i++) {
+        solver->buffer[i] = dimacs_to_lit(assumptions[i]);
+    }
+
+    bool result = solve_assuming(solver->formula, assignment, solver->buffer, size);
+    if (result) {
+        return true;
+    }
+    if (!assignment->assumption_failed) {
+        solver->unsatisfiable = !assignment->interrupted;
+        return false;
+    }
+    solver->core = (Literal*)realloc(solver->core, assignment->core_size * sizeof(Literal));
+    if (!solver->core) {
+        perror("Failed to reallocate memory for assumption core");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < assignment->core_size; i++) {
+        solver->core[i] = lit_to_dimacs(assignment->core[i]);
+    }
+    solver->core_size = assignment->core_size;
+    return false;
+}
+
+// Value of lit in the model of the last satisfiable call: LITERAL_TRUE,
+// LITERAL_FALSE, or LITERAL_UNASSIGNED for a variable the solver never saw
+int solver_value(SatSolver* solver, Literal lit) {
+    if (lit == 0 || abs(lit) > solver->assignment->size) {
+        return LITERAL_UNASSIGNED;
+    }
+    return literal_value(solver->assignment, dimacs_to_lit(lit));
+}
+
+// Assumptions of the last unsatisfiable call that cannot all hold together
+const Literal* solver_core(SatSolver* solver, int* size) {
+    *size = solver->core_size;
+    return solver->core;
+}
@@ -0,0 +1,410 @@
+#include "sat.h"
+#include <bzlib.h>
+#include <lzma.h>
+#include <zlib.h>
+
+// Input streams. The compression of a file is recognised from its first
+// bytes and the data is decompressed one chunk at a time as the parser asks
+// for it, so compressed instances never exist uncompressed in full, neither
+// on disk nor in memory. Concatenated gzip, xz and bzip2 streams are read
+// back to back, as the command line tools do.
+
+#define INPUT_CHUNK_SIZE (1 << 16)
+#define MAGIC_SIZE 6
+
+struct InputStream {
+    FILE* file;
+    int compression;
+    unsigned char* in; //compressed bytes read from the file
+    size_t in_size;
+    size_t in_pos;
+    bool file_end;
+    bool stream_end; //the current compressed stream is complete
+    bool error;
+    z_stream gzip;
+    lzma_stream xz;
+    bz_stream bzip2;
+};
+
+int detect_compression(const unsigned char* magic, size_t size) {
+    if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (size >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return COMPRESSION_XZ;
+    }
+    if (size >= 3 && memcmp(magic, "BZh", 3) == 0) {
+        return COMPRESSION_BZIP2;
+    }
+    return COMPRESSION_NONE;
+}
+
+static bool start_decoder(InputStream* input) {
+    switch (input->compression) {
+        case COMPRESSION_GZIP:
+            memset(&input->gzip, 0, sizeof(input->gzip));
+            // 15 + 16: gzip header only
+            return inflateInit2(&input->gzip, 15 + 16) == Z_OK;
+        case COMPRESSION_XZ: {
+            lzma_stream init = LZMA_STREAM_INIT;
+            input->xz = init;
+            return lzma_stream_decoder(&input->xz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+        }
+        case COMPRESSION_BZIP2:
+            memset(&input->bzip2, 0, sizeof(input->bzip2));
+            return BZ2_bzDecompressInit(&input->bzip2, 0, 0) == BZ_OK;
+    }
+    return true;
+}
+
+static void end_decoder(InputStream* input) {
+    switch (input->compression) {
+        case COMPRESSION_GZIP:
+            inflateEnd(&input->gzip);
+            break;
+        case COMPRESSION_XZ:
+            lzma_end(&input->xz);
+            break;
+        case COMPRESSION_BZIP2:
+            BZ2_bzDecompressEnd(&input->bzip2);
+            break;
+    }
+}
+
+// Open a stream on file, which is read from its current position. The file is not closed by input_close().
+InputStream* input_open(FILE* file) {
+    InputStream* input = (InputStream*)calloc(1, sizeof(InputStream));
+    if (input) {
+        input->in = (unsigned char*)malloc(INPUT_CHUNK_SIZE);
+    }
+    if (!input || !input->in) {
+        perror("Failed to allocate memory for input stream");
+        exit(EXIT_FAILURE);
+    }
+    input->file = file;
+
+    // the magic bytes stay in the buffer as the first input, so pipes work too
+    input->in_size = fread(input->in, 1, MAGIC_SIZE, file);
+    input->compression = detect_compression(input->in, input->in_size);
+    if (!start_decoder(input)) {
+        fprintf(stderr, "Failed to initialise the decompressor\n");
+        free(input->in);
+        free(input);
+        return NULL;
+    }
+    return input;
+}
+
+void input_close(InputStream* input) {
+    if (!input) return;
+    end_decoder(input);
+    free(input->in);
+    free(input);
+}
+
+// Make sure there are unread compressed bytes, returns false at the end of the file
+static bool fill_input(InputStream* input) {
+    if (input->in_pos < input->in_size) {
+        return true;
+    }
+    if (input->file_end) {
+        return false;
+    }
+    input->in_size = fread(input->in, 1, INPUT_CHUNK_SIZE, input->file);
+    input->in_pos = 0;
+    if (input->in_size == 0) {
+        input->file_end = true;
+        if (ferror(input->file)) {
+            perror("Failed to read input");
+            input->error = true;
+        }
+        return false;
+    }
+    return true;
+}
+
+static size_t read_gzip(InputStream* input, char* buffer, size_t size) {
+    z_stream* z = &input->gzip;
+    z->next_out = (Bytef*)buffer;
+    z->avail_out = size;
+    while (z->avail_out > 0) {
+        if (input->stream_end) {
+            // another gzip member may follow, anything else is ignored like gzip does
+            if (!fill_input(input) || input->in[input->in_pos] != 0x1f) {
+                input->in_pos = input->in_size;
+                input->file_end = true;
+                break;
+            }
+            inflateReset(z);
+            input->stream_end = false;
+        }
+        if (!fill_input(input)) {
+            fprintf(stderr, "Unexpected end of gzip data\n");
+            input->error = true;
+            break;
+        }
+        z->next_in = input->in + input->in_pos;
+        z->avail_in = input->in_size - input->in_pos;
+        int status = inflate(z, Z_NO_FLUSH);
+        input->in_pos = input->in_size - z->avail_in;
+        if (status == Z_STREAM_END) {
+            input->stream_end = true;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            fprintf(stderr, "Corrupt gzip data: %s\n", z->msg ? z->msg : "unknown error");
+            input->error = true;
+            break;
+        }
+    }
+    return size - z->avail_out;
+}
+
+static size_t read_xz(InputStream* input, char* buffer, size_t size) {
+    lzma_stream* x = &input->xz;
+    x->next_out = (uint8_t*)buffer;
+    x->avail_out = size;
+    while (x->avail_out > 0 && !input->stream_end) {
+        // LZMA_FINISH tells a concatenated decoder that no more streams follow
+        lzma_action action = fill_input(input) ? LZMA_RUN : LZMA_FINISH;
+        x->next_in = input->in + input->in_pos;
+        x->avail_in = input->in_size - input->in_pos;
+        lzma_ret status = lzma_code(x, action);
+        input->in_pos = input->in_size - x->avail_in;
+        if (status == LZMA_STREAM_END) {
+            input->stream_end = true;
+        } else if (status != LZMA_OK) {
+            fprintf(stderr, "Corrupt xz data (error %d)\n", (int)status);
+            input->error = true;
+            break;
+        }
+    }
+    return size - x->avail_out;
+}
+
+static size_t read_bzip2(InputStream* input, char* buffer, size_t size) {
+    bz_stream* b = &input->bzip2;
+    b->next_out = buffer;
+    b->avail_out = size;
+    while (b->avail_out > 0) {
+        if (input->stream_end) {
+            if (!fill_input(input) || input->in[input->in_pos] != 'B') {
+                input->in_pos = input->in_size;
+                input->file_end = true;
+                break;
+            }
+            BZ2_bzDecompressEnd(b);
+            memset(b, 0, sizeof(*b));
+            BZ2_bzDecompressInit(b, 0, 0);
+            input->stream_end = false;
+        }
+        if (!fill_input(input)) {
+            fprintf(stderr, "Unexpected end of bzip2 data\n");
+            input->error = true;
+            break;
+        }
+        b->next_in = (char*)input->in + input->in_pos;
+        b->avail_in = input->in_size - input->in_pos;
+        int status = BZ2_bzDecompress(b);
+        input->in_pos = input->in_size - b->avail_in;
+        if (status == BZ_STREAM_END) {
+            input->stream_end = true;
+        } else if (status != BZ_OK) {
+            fprintf(stderr, "Corrupt bzip2 data (error %d)\n", status);
+            input->error = true;
+            break;
+        }
+    }
+    return size - b->avail_out;
+}
+
+// Read up to size decompressed bytes. Returns 0 at the end of the data and -1 on an error.
+long input_read(InputStream* input, char* buffer, size_t size) {
+    if (input->error) {
+        return -1;
+    }
+    size_t n = 0;
+    switch (input->compression) {
+        case COMPRESSION_NONE:
+            if (fill_input(input)) {
+                n = input->in_size - input->in_pos;
+                if (n > size) {
+                    n = size;
+                }
+                memcpy(buffer, input->in + input->in_pos, n);
+                input->in_pos += n;
+            }
+            break;
+        case COMPRESSION_GZIP:
+            n = read_gzip(input, buffer, size);
+            break;
+        case COMPRESSION_XZ:
+            n = read_xz(input, buffer, size);
+            break;
+        case COMPRESSION_BZIP2:
+            n = read_bzip2(input, buffer, size);
+            break;
+    }
+    if (n == 0 && input->error) {
+        return -1;
+    }
+    return (long)n;
+}
+
+// Read exactly size bytes, returns false on a short read
+static bool input_read_full(InputStream* input, char* buffer, size_t size) {
+    while (size > 0) {
+        long n = input_read(input, buffer, size);
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Tar archives: 512-byte headers, each followed by the member data padded to
+// a multiple of 512 bytes; two zero blocks end the archive.
+
+#define TAR_BLOCK 512
+
+static long long tar_octal(const char* field, int size) {
+    long long value = 0;
+    for (int i = 0; i < size && field[i]; i++) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        } else if (field[i] != ' ') {
+            break;
+        }
+    }
+    return value;
+}
+
+static bool ends_with(const char* name, const char* suffix) {
+    size_t n = strlen(name), m = strlen(suffix);
+    return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+// Parse the next size bytes of input as one DIMACS formula, then skip the padding
+static Formula* parse_tar_member(InputStream* input, char* chunk, long long size, bool* ok) {
+    DimacsParser parser;
+    dimacs_init(&parser);
+    long long padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+    long long left = padded;
+    bool valid = true;
+    while (left > 0) {
+        size_t want = left < INPUT_CHUNK_SIZE ? (size_t)left : INPUT_CHUNK_SIZE;
+        if (!input_read_full(input, chunk, want)) {
+            *ok = false;
+            break;
+        }
+        // only the member data goes to the parser, not the padding
+        long long data_left = size - (padded - left);
+        size_t data = data_left <= 0 ? 0 : (data_left < (long long)want ? (size_t)data_left : want);
+        if (valid && data > 0) {
+            valid = dimacs_feed(&parser, chunk, data);
+        }
+        left -= want;
+    }
+    return dimacs_finish(&parser);
+}
+
+// Call handler for every .cnf member of a (possibly compressed) tar archive.
+// The handler owns the formula, which is NULL if the member failed to parse.
+// Returns the number of .cnf members, or -1 if the archive could not be read.
+int parse_cnf_tar(const char* filename, TarMemberHandler handler, void* context) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open file");
+        return -1;
+    }
+    InputStream* input = input_open(file);
+    if (!input) {
+        fclose(file);
+        return -1;
+    }
+    char* chunk = (char*)malloc(INPUT_CHUNK_SIZE);
+    if (!chunk) {
+        perror("Failed to allocate memory for input buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    char header[TAR_BLOCK];
+    char name[4096];
+    bool long_name = false;
+    bool ok = true;
+    int members = 0;
+    while (true) {
+        if (!input_read_full(input, header, TAR_BLOCK)) {
+            // a missing end-of-archive marker is tolerated
+            ok = !input->error;
+            break;
+        }
+        if (header[0] == '\0') {
+            break;
+        }
+        long long size = tar_octal(header + 124, 12);
+        char type = header[156];
+
+        if (type == 'L') {
+            // GNU long name: the data is the name of the next member
+            long long padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+            long long stored = 0;
+            while (stored < padded) {
+                if (!input_read_full(input, chunk, TAR_BLOCK)) {
+                    ok = false;
+                    break;
+                }
+                long long n = size - stored;
+                if (n > TAR_BLOCK) n = TAR_BLOCK;
+                if (n > 0 && stored + n < (long long)sizeof(name)) {
+                    memcpy(name + stored, chunk, n);
+                }
+                stored += TAR_BLOCK;
+            }
+            name[size < (long long)sizeof(name) ? size : (long long)sizeof(name) - 1] = '\0';
+            long_name = true;
+            if (!ok) break;
+            continue;
+        }
+        if (!long_name) {
+            // ustar splits long paths into prefix/name
+            if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+                snprintf(name, sizeof(name), "%.155s/%.100s", header + 345, header);
+            } else {
+                snprintf(name, sizeof(name), "%.100s", header);
+            }
+        }
+        long_name = false;
+
+        if ((type == '0' || type == '\0') && ends_with(name, ".cnf")) {
+            Formula* formula = parse_tar_member(input, chunk, size, &ok);
+            if (!ok) {
+                free_formula(formula);
+                break;
+            }
+            members++;
+            handler(name, formula, context);
+            continue;
+        }
+
+        // skip anything else: directories, pax headers, other files
+        long long left = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        while (left > 0) {
+            size_t want = left < INPUT_CHUNK_SIZE ? (size_t)left : INPUT_CHUNK_SIZE;
+            if (!input_read_full(input, chunk, want)) {
+                ok = false;
+                break;
+            }
+            left -= want;
+        }
+        if (!ok) break;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Truncated or corrupt tar archive: %s\n", filename);
+    }
+    free(chunk);
+    input_close(input);
+    fclose(file);
+    return ok ? members : -1;
+}
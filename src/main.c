@@ -1,20 +1,117 @@
 #include "sat.h"
 
 void print_usage(const char* program_name) {
-    printf("Usage: %s <cnf_file>\n", program_name);
-    printf("  <cnf_file>: Path to a CNF formula file in DIMACS format\n");
+    printf("Usage: %s [options] <cnf_file>\n", program_name);
+    printf("  <cnf_file>: Path to a CNF formula file in DIMACS format, optionally gzip, xz or bzip2 compressed\n");
+    printf("Options:\n");
+    printf("  --tar: <cnf_file> is a (compressed) tar archive, solve every .cnf member\n");
+    printf("  --batch: <cnf_file> is a directory, a glob pattern or a file listing one instance per line;\n");
+    printf("           solve them all in one process and print a CSV row per instance\n");
+    printf("  --csv=<file>: write the batch CSV to <file> instead of stdout\n");
+    printf("  --heuristic=<vsids|static>: decision heuristic (default: vsids)\n");
+    printf("  --polarity=<saved|true|false|random|target|best>: value of decision variables (default: saved)\n");
+    printf("  --seed=<n>: seed for the random choices of the solver\n");
+    printf("  --restart=<glucose|luby|none>: restart policy (default: glucose)\n");
+    printf("  --restart-unit=<n>: conflicts per unit of the Luby sequence (default: 100)\n");
+    printf("  --threads=<n>: race n differently configured searches, the first to finish wins (default: 1)\n");
+    printf("  --no-preprocess: search the formula as parsed (apart from probing), without subsumption\n");
+    printf("                   and variable elimination\n");
+    printf("  --no-probe: no failed-literal probing or equivalent-literal substitution\n");
+    printf("  --sls=<none|only|hybrid>: probSAT local search instead of CDCL (only, may end UNKNOWN)\n");
+    printf("                            or at restarts to set the saved phases (hybrid) (default: hybrid)\n");
+    printf("  --stats[=text|json]: print search statistics and the time of each phase on stderr\n");
+    printf("  --progress=<n>: print a progress line on stderr every n conflicts\n");
+    printf("  --cube-depth=<n>: cube and conquer, split the formula into up to 2^n cubes by lookahead\n");
+    printf("                    and solve them on --threads workers (default: 0, no splitting)\n");
+    printf("  --no-share: parallel threads do not exchange learned clauses\n");
+    printf("  --share-size=<n>, --share-lbd=<n>: longest clause and highest LBD shared (default: 8, 2)\n");
+    printf("  --proof=<file>: write a DRAT proof of unsatisfiability to <file> (single-threaded search only)\n");
+    printf("  --proof-format=<binary|text>: encoding of the proof (default: binary)\n");
+    printf("  --check-proof=<file>: check the DRAT proof in <file> against <cnf_file> instead of solving\n");
+}
+
+// Parse a --name=value option into options, returns false if it is not recognised
+bool parse_option(const char* arg, SolverOptions* options) {
+    if (strcmp(arg, "--heuristic=vsids") == 0) {
+        options->decision_heuristic = HEURISTIC_VSIDS;
+    } else if (strcmp(arg, "--heuristic=static") == 0) {
+        options->decision_heuristic = HEURISTIC_STATIC;
+    } else if (strcmp(arg, "--polarity=saved") == 0) {
+        options->polarity = POLARITY_SAVED;
+    } else if (strcmp(arg, "--polarity=true") == 0) {
+        options->polarity = POLARITY_TRUE;
+    } else if (strcmp(arg, "--polarity=false") == 0) {
+        options->polarity = POLARITY_FALSE;
+    } else if (strcmp(arg, "--polarity=random") == 0) {
+        options->polarity = POLARITY_RANDOM;
+    } else if (strcmp(arg, "--polarity=target") == 0) {
+        options->polarity = POLARITY_TARGET;
+    } else if (strcmp(arg, "--polarity=best") == 0) {
+        options->polarity = POLARITY_BEST;
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+        options->seed = strtoull(arg + 7, NULL, 10);
+    } else if (strcmp(arg, "--restart=glucose") == 0) {
+        options->restart_policy = RESTART_GLUCOSE;
+    } else if (strcmp(arg, "--restart=luby") == 0) {
+        options->restart_policy = RESTART_LUBY;
+    } else if (strcmp(arg, "--restart=none") == 0) {
+        options->restart_policy = RESTART_NONE;
+    } else if (strncmp(arg, "--threads=", 10) == 0) {
+        options->threads = atoi(arg + 10);
+        if (options->threads < 1) {
+            return false;
+        }
+    } else if (strncmp(arg, "--cube-depth=", 13) == 0) {
+        options->cube_depth = atoi(arg + 13);
+        if (options->cube_depth < 0 || options->cube_depth > CUBE_MAX_DEPTH) {
+            return false;
+        }
+    } else if (strcmp(arg, "--no-preprocess") == 0) {
+        options->preprocess = false;
+    } else if (strcmp(arg, "--no-probe") == 0) {
+        options->probe = false;
+    } else if (strcmp(arg, "--sls=none") == 0) {
+        options->sls = SLS_NONE;
+    } else if (strcmp(arg, "--sls=only") == 0) {
+        options->sls = SLS_ONLY;
+    } else if (strcmp(arg, "--sls=hybrid") == 0) {
+        options->sls = SLS_HYBRID;
+    } else if (strcmp(arg, "--stats") == 0 || strcmp(arg, "--stats=text") == 0) {
+        options->stats = STATS_TEXT;
+    } else if (strcmp(arg, "--stats=json") == 0) {
+        options->stats = STATS_JSON;
+    } else if (strncmp(arg, "--progress=", 11) == 0) {
+        options->progress = atoll(arg + 11);
+        if (options->progress < 1) {
+            return false;
+        }
+    } else if (strcmp(arg, "--no-share") == 0) {
+        options->share = false;
+    } else if (strncmp(arg, "--share-size=", 13) == 0) {
+        options->share_max_size = atoi(arg + 13);
+    } else if (strncmp(arg, "--share-lbd=", 12) == 0) {
+        options->share_max_lbd = atoi(arg + 12);
+    } else if (strncmp(arg, "--restart-unit=", 15) == 0) {
+        options->restart_unit = atoi(arg + 15);
+        if (options->restart_unit < 1) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return true;
 }
 
 void print_formula(Formula* formula) {
     printf("CNF Formula with %d variables and %d clauses:\n", formula->num_variables, formula->size);
     
     for (int i = 0; i < formula->size; i++) {
-        Clause* clause = &formula->clauses[i];
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
         printf("Clause %d: (", i + 1);
         
-        for (int j = 0; j < clause->size; j++) {
-            printf("%d", clause->literals[j]);
-            if (j < clause->size - 1) {
+        for (int j = 0; j < (int)clause->size; j++) {
+            printf("%d", lit_to_dimacs(clause->literals[j]));
+            if (j < (int)clause->size - 1) {
                 printf(" ∨ ");
             }
         }
@@ -23,30 +120,54 @@ void print_formula(Formula* formula) {
     }
 }
 
-int main(int argc, char* argv[]) {
-    // Check arguments
-    if (argc != 2) {
-        print_usage(argv[0]);
-        return EXIT_FAILURE;
+// Solve a formula and print the result. Frees the formula.
+// parse_seconds is only reported in the statistics.
+void solve_formula(Formula* formula, SolverOptions* options, double parse_seconds) {
+    Assignment* assignment;
+    bool result;
+    ReconstructionStack eliminated = {NULL, 0, 0};
+    PhaseTimes times = {parse_seconds, 0, 0, 0};
+    PhaseCounters counters;
+    memset(&counters, 0, sizeof(counters));
+    double start = stats_clock();
+    if (options->preprocess) {
+        formula = preprocess_formula(formula, &eliminated, options->probe, &counters);
+    } else if (options->probe) {
+        probe_search_formula(formula, &eliminated, &counters);
     }
-    
-    // Parse the CNF file
-    Formula* formula = parse_cnf_file(argv[1]);
-    if (!formula) {
-        fprintf(stderr, "Failed to parse the CNF file: %s\n", argv[1]);
-        return EXIT_FAILURE;
+    times.preprocess = stats_clock() - start;
+    start = stats_clock();
+    if (options->cube_depth > 0) {
+        assignment = solve_cubes(formula, options, &result, &counters);
+    } else if (options->threads > 1) {
+        assignment = solve_portfolio(formula, options, &result, &counters);
+    } else {
+        // Create an empty assignment
+        assignment = create_assignment(formula->num_variables);
+        assignment->options = *options;
+
+        // Solve the formula
+        result = solve(formula, assignment);
+    }
+    if (!result && !assignment->interrupted && formula->proof) {
+        proof_add(formula->proof, NULL, 0);
+    }
+    times.search = stats_clock() - start;
+
+    // the model is checked against the formula that was searched, before
+    // eliminated variables get their values
+    bool verified = false;
+    if (result && options->stats != STATS_NONE) {
+        start = stats_clock();
+        verified = is_satisfied(formula, assignment);
+        times.verify = stats_clock() - start;
+        if (!verified) {
+            fprintf(stderr, "c Verification Error: the assignment does not satisfy all clauses!\n");
+        }
     }
-    
-    // Print the formula
-    // print_formula(formula);
-    
-    // Create an empty assignment
-    Assignment* assignment = create_assignment(formula->num_variables);
-    
-    // Solve the formula
-    bool result = solve(formula, assignment);
     // Print the result
     if (result) {
+        extend_model(&eliminated, assignment);
         printf("RESULT: SAT\n");
         print_assignment(assignment);
         
@@ -58,13 +179,147 @@ int main(int argc, char* argv[]) {
             printf("\nVerification Error: The assignment does not satisfy all clauses!\n");
         }
         */
+    } else if (assignment->interrupted) {
+        printf("RESULT: UNKNOWN\n");
     } else {
         printf("RESULT: UNSAT\n");
     }
     
+    if (options->stats != STATS_NONE) {
+        const char* outcome = result ? "SAT" : assignment->interrupted ? "UNKNOWN" : "UNSAT";
+        fflush(stdout);
+        print_stats(stderr, options->stats, outcome, verified, formula, assignment, &times, &counters);
+    }
+
     // Free memory
+    free_reconstruction(&eliminated);
     free_assignment(assignment);
     free_formula(formula);
+}
+
+// Tar mode: every member is solved as soon as it has been parsed
+static void solve_tar_member(const char* name, Formula* formula, void* context) {
+    printf("INSTANCE: %s\n", name);
+    if (!formula) {
+        fprintf(stderr, "Failed to parse the CNF file: %s\n", name);
+        printf("RESULT: ERROR\n");
+        return;
+    }
+    // members are parsed as the archive is read, so their parse time is not measured
+    solve_formula(formula, (SolverOptions*)context, 0);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    // Check arguments
+    SolverOptions options = default_solver_options();
+    const char* filename = NULL;
+    const char* csv_filename = NULL;
+    const char* proof_filename = NULL;
+    const char* check_filename = NULL;
+    bool binary_proof = true;
+    bool tar = false;
+    bool batch = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tar") == 0) {
+            tar = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strncmp(argv[i], "--csv=", 6) == 0) {
+            csv_filename = argv[i] + 6;
+        } else if (strncmp(argv[i], "--proof=", 8) == 0) {
+            proof_filename = argv[i] + 8;
+        } else if (strcmp(argv[i], "--proof-format=binary") == 0) {
+            binary_proof = true;
+        } else if (strcmp(argv[i], "--proof-format=text") == 0) {
+            binary_proof = false;
+        } else if (strncmp(argv[i], "--check-proof=", 14) == 0) {
+            check_filename = argv[i] + 14;
+        } else if (argv[i][0] == '-') {
+            if (!parse_option(argv[i], &options)) {
+                fprintf(stderr, "Unknown option: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!filename) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (batch && options.threads > 1) {
+        fprintf(stderr, "--threads cannot be combined with --batch, instances are solved one thread each\n");
+        return EXIT_FAILURE;
+    }
+    if (batch && options.cube_depth > 0) {
+        fprintf(stderr, "--cube-depth cannot be combined with --batch, instances are solved without splitting\n");
+        return EXIT_FAILURE;
+    }
+    if (proof_filename && (batch || tar || options.threads > 1 || options.cube_depth > 0)) {
+        fprintf(stderr, "--proof needs a single instance and a single search thread\n");
+        return EXIT_FAILURE;
+    }
+
+    if (batch) {
+        FILE* csv = csv_filename ? fopen(csv_filename, "w") : stdout;
+        if (!csv) {
+            perror("Failed to open the CSV file");
+            return EXIT_FAILURE;
+        }
+        int errors = run_batch(filename, &options, csv);
+        if (csv != stdout) {
+            fclose(csv);
+        }
+        return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (tar) {
+        int members = parse_cnf_tar(filename, solve_tar_member, &options);
+        if (members < 0) {
+            return EXIT_FAILURE;
+        }
+        if (members == 0) {
+            fprintf(stderr, "No .cnf files in the archive: %s\n", filename);
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    // Parse the CNF file
+    double start = stats_clock();
+    Formula* formula = parse_cnf_file(filename);
+    double parse_seconds = stats_clock() - start;
+    if (!formula) {
+        fprintf(stderr, "Failed to parse the CNF file: %s\n", filename);
+        return EXIT_FAILURE;
+    }
+    
+    // Print the formula
+    // print_formula(formula);
+
+    if (check_filename) {
+        bool verified = check_proof(formula, check_filename);
+        free_formula(formula);
+        return verified ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    Proof* proof = NULL;
+    if (proof_filename) {
+        proof = open_proof(proof_filename, binary_proof);
+        if (!proof) {
+            free_formula(formula);
+            return EXIT_FAILURE;
+        }
+        formula->proof = proof;
+    }
+    
+    solve_formula(formula, &options, parse_seconds);
+    if (proof && !close_proof(proof)) {
+        return EXIT_FAILURE;
+    }
     
     return EXIT_SUCCESS;
-} 
\ No newline at end of file
+}
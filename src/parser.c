@@ -1,79 +1,335 @@
 #include "sat.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-Formula* parse_cnf_file(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Failed to open file");
-        return NULL;
+// DIMACS parser. The input is scanned byte by byte by a small state machine
+// that can be fed the file in arbitrary chunks, so a memory-mapped file is
+// parsed in one call and a stream in fixed-size reads. Integers are scanned
+// by hand and literals are collected in one reusable buffer that is copied
+// straight into the clause arena when the terminating 0 is read. Clauses may
+// span lines and a line may hold several clauses. A '%' at the start of a
+// line ends the input (SATLIB files carry a "%\n0\n" trailer).
+
+#define DIMACS_CHUNK_SIZE (1 << 16)
+
+enum {
+    DIMACS_LINE_START,
+    DIMACS_COMMENT,
+    DIMACS_HEADER,
+    DIMACS_BODY,
+    DIMACS_NUMBER,
+    DIMACS_END,
+    DIMACS_ERROR
+};
+
+void dimacs_init(DimacsParser* parser) {
+    parser->formula = NULL;
+    parser->recycled = NULL;
+    parser->state = DIMACS_LINE_START;
+    parser->line = 1;
+    parser->header_size = 0;
+    parser->num_variables = 0;
+    parser->num_clauses = 0;
+    parser->negative = false;
+    parser->digits = 0;
+    parser->value = 0;
+    parser->literals = NULL;
+    parser->size = 0;
+    parser->capacity = 0;
+}
+
+static bool parse_error(DimacsParser* parser, const char* message) {
+    fprintf(stderr, "DIMACS line %ld: %s\n", parser->line, message);
+    parser->state = DIMACS_ERROR;
+    return false;
+}
+
+static bool parse_header(DimacsParser* parser) {
+    parser->header[parser->header_size] = '\0';
+    if (parser->formula) {
+        return parse_error(parser, "duplicate problem line");
     }
-    
-    Formula* formula = parse_cnf_dimacs(file);
-    fclose(file);
-    return formula;
+    if (sscanf(parser->header, "p cnf %d %d", &parser->num_variables, &parser->num_clauses) != 2
+        || parser->num_variables <= 0 || parser->num_clauses <= 0) {
+        fprintf(stderr, "Invalid problem line format: %s\n", parser->header);
+        parser->state = DIMACS_ERROR;
+        return false;
+    }
+    if (parser->recycled) {
+        parser->formula = parser->recycled;
+        clear_formula(parser->formula);
+    } else {
+        parser->formula = create_formula();
+    }
+    parser->formula->num_variables = parser->num_variables;
+    return true;
 }
 
-Formula* parse_cnf_dimacs(FILE* file) {
-    char line[1024];
-    int num_variables = 0, num_clauses = 0;
-    
-    // Skip comments and find problem line
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == 'c') {
-            // Comment line - skip
-            continue;
-        } else if (line[0] == 'p') {
-            // Problem line - parse number of variables and clauses
-            if (sscanf(line, "p cnf %d %d", &num_variables, &num_clauses) != 2) {
-                fprintf(stderr, "Invalid problem line format: %s\n", line);
-                return NULL;
+// A number token ended: either a literal or the 0 closing the clause
+static bool end_number(DimacsParser* parser) {
+    if (parser->digits == 0) {
+        return parse_error(parser, "'-' without a number");
+    }
+    if (!parser->formula) {
+        return parse_error(parser, "clause before the problem line");
+    }
+    if (parser->value == 0) {
+        add_original_clause(parser->formula, parser->literals, parser->size);
+        parser->size = 0;
+    } else {
+        if (parser->size >= parser->capacity) {
+            parser->capacity = parser->capacity ? parser->capacity * 2 : 64;
+            parser->literals = (Lit*)realloc(parser->literals, parser->capacity * sizeof(Lit));
+            if (!parser->literals) {
+                perror("Failed to reallocate memory for clause literals");
+                exit(EXIT_FAILURE);
             }
-            break;
         }
+        parser->literals[parser->size++] = make_lit((int)parser->value - 1, parser->negative);
     }
-    
-    if (num_variables == 0 || num_clauses == 0) {
+    parser->negative = false;
+    parser->digits = 0;
+    parser->value = 0;
+    return true;
+}
+
+// Consume the next chunk of input. Returns false once the input is known to be invalid.
+bool dimacs_feed(DimacsParser* parser, const char* data, size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+    int state = parser->state;
+
+    while (p < end) {
+        char c = *p;
+        switch (state) {
+            case DIMACS_LINE_START:
+                if (c == ' ' || c == '\t') {
+                    p++;
+                    continue;
+                }
+                if (c == 'c') {
+                    state = DIMACS_COMMENT;
+                    p++;
+                    continue;
+                }
+                if (c == 'p') {
+                    state = DIMACS_HEADER;
+                    parser->header_size = 0;
+                    continue;
+                }
+                if (c == '%') {
+                    state = DIMACS_END;
+                    continue;
+                }
+                state = DIMACS_BODY;
+                continue;
+
+            case DIMACS_COMMENT: {
+                const char* newline = memchr(p, '\n', end - p);
+                if (!newline) {
+                    p = end;
+                    continue;
+                }
+                p = newline + 1;
+                parser->line++;
+                state = DIMACS_LINE_START;
+                continue;
+            }
+
+            case DIMACS_HEADER:
+                p++;
+                if (c == '\n') {
+                    parser->state = state;
+                    if (!parse_header(parser)) {
+                        return false;
+                    }
+                    parser->line++;
+                    state = DIMACS_LINE_START;
+                } else if (parser->header_size < (int)sizeof(parser->header) - 1) {
+                    parser->header[parser->header_size++] = c;
+                }
+                continue;
+
+            case DIMACS_BODY:
+                p++;
+                if (c == '\n') {
+                    parser->line++;
+                    state = DIMACS_LINE_START;
+                } else if (c == ' ' || c == '\t' || c == '\r') {
+                    // separator
+                } else if (c == '-') {
+                    parser->negative = true;
+                    state = DIMACS_NUMBER;
+                } else if (c >= '0' && c <= '9') {
+                    parser->value = c - '0';
+                    parser->digits = 1;
+                    state = DIMACS_NUMBER;
+                } else {
+                    parser->state = state;
+                    return parse_error(parser, "unexpected character");
+                }
+                continue;
+
+            case DIMACS_NUMBER:
+                // the hot loop: scan the digits of one literal
+                while (p < end && *p >= '0' && *p <= '9') {
+                    parser->value = parser->value * 10 + (*p - '0');
+                    parser->digits++;
+                    if (parser->value > INT_MAX / 2) {
+                        parser->state = state;
+                        return parse_error(parser, "variable index out of range");
+                    }
+                    p++;
+                }
+                if (p == end) {
+                    continue;
+                }
+                c = *p;
+                if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                    parser->state = state;
+                    return parse_error(parser, "unexpected character in number");
+                }
+                parser->state = state;
+                if (!end_number(parser)) {
+                    return false;
+                }
+                state = DIMACS_BODY;
+                continue;
+
+            case DIMACS_END:
+                p = end;
+                continue;
+
+            default:
+                return false;
+        }
+    }
+    parser->state = state;
+    return true;
+}
+
+// Flush the last token and hand over the formula. Frees the parser's buffers;
+// returns NULL (and frees the partial formula unless it was recycled) if the
+// input was invalid.
+Formula* dimacs_finish(DimacsParser* parser) {
+    bool ok = parser->state != DIMACS_ERROR;
+    if (ok && parser->state == DIMACS_HEADER) {
+        ok = parse_header(parser);
+    }
+    if (ok && parser->state == DIMACS_NUMBER) {
+        ok = end_number(parser);
+    }
+    // tolerate a last clause without its terminating 0
+    if (ok && parser->size > 0) {
+        add_original_clause(parser->formula, parser->literals, parser->size);
+        parser->size = 0;
+    }
+    if (ok && !parser->formula) {
         fprintf(stderr, "Missing or invalid problem line\n");
+        ok = false;
+    }
+
+    Formula* formula = parser->formula;
+    free(parser->literals);
+    parser->literals = NULL;
+    parser->formula = NULL;
+    if (!ok) {
+        if (formula != parser->recycled) {
+            free_formula(formula);
+        }
         return NULL;
     }
-    
-    Formula* formula = create_formula();
-    formula->num_variables = num_variables;
-    
-    // Parse clauses
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == 'c') {
-            // Comment line - skip
-            continue;
+
+    // Verify we read the expected number of clauses
+    if (formula->size != parser->num_clauses) {
+        fprintf(stderr, "Warning: Expected %d clauses, but read %d\n",
+                parser->num_clauses, formula->size);
+    }
+    return formula;
+}
+
+static Formula* parse_buffer(const char* data, size_t size, Formula* recycled) {
+    DimacsParser parser;
+    dimacs_init(&parser);
+    parser.recycled = recycled;
+    dimacs_feed(&parser, data, size);
+    return dimacs_finish(&parser);
+}
+
+// Parse a stream, decompressing it on the fly if needed
+static Formula* parse_stream(FILE* file, Formula* recycled) {
+    InputStream* input = input_open(file);
+    if (!input) {
+        return NULL;
+    }
+    char* chunk = (char*)malloc(DIMACS_CHUNK_SIZE);
+    if (!chunk) {
+        perror("Failed to allocate memory for input buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    DimacsParser parser;
+    dimacs_init(&parser);
+    parser.recycled = recycled;
+    long n;
+    while ((n = input_read(input, chunk, DIMACS_CHUNK_SIZE)) > 0) {
+        if (!dimacs_feed(&parser, chunk, n)) {
+            break;
         }
-        
-        // Parse literals in the clause
-        Clause* clause = create_clause();
-        char* token = strtok(line, " \t\n");
-        
-        while (token) {
-            int lit = atoi(token);
-            if (lit == 0) {
-                // End of clause
-                break;
-            }
-            
-            add_literal(clause, lit);
-            token = strtok(NULL, " \t\n");
+    }
+    if (n < 0) {
+        parser.state = DIMACS_ERROR;
+    }
+    free(chunk);
+    input_close(input);
+    return dimacs_finish(&parser);
+}
+
+Formula* parse_cnf_buffer(const char* data, size_t size) {
+    return parse_buffer(data, size, NULL);
+}
+
+Formula* parse_cnf_dimacs(FILE* file) {
+    return parse_stream(file, NULL);
+}
+
+Formula* parse_cnf_file(const char* filename) {
+    return parse_cnf_file_into(filename, NULL);
+}
+
+// Uncompressed regular files are memory-mapped and parsed in place; anything
+// else (compressed files, pipes, terminals) goes through the chunked stream
+// parser. If recycled is not NULL it is cleared and filled instead of
+// allocating a new formula.
+Formula* parse_cnf_file_into(const char* filename, Formula* recycled) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open file");
+        return NULL;
+    }
+
+    struct stat info;
+    int fd = fileno(file);
+    unsigned char magic[8];
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        ssize_t n = pread(fd, magic, sizeof(magic), 0);
+        void* data = MAP_FAILED;
+        if (n > 0 && detect_compression(magic, n) == COMPRESSION_NONE) {
+            data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
         }
-        
-        // Add clause to formula if it's not empty
-        if (clause->size > 0) {
-            add_clause(formula, clause);
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            Formula* formula = parse_buffer((const char*)data, info.st_size, recycled);
+            munmap(data, info.st_size);
+            fclose(file);
+            return formula;
         }
-        
-        free(clause);
     }
-    
-    // Verify we read the expected number of clauses
-    if (formula->size != num_clauses) {
-        fprintf(stderr, "Warning: Expected %d clauses, but read %d\n", 
-                num_clauses, formula->size);
-    }
-    
+
+    Formula* formula = parse_stream(file, recycled);
+    fclose(file);
     return formula;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,167 @@
+#include "sat.h"
+#include <pthread.h>
+
+// Portfolio solving: several differently configured searches race on the
+// same formula and the first one to finish decides the answer. The parsed
+// formula is shared read-only; every thread starts from its own copy of the
+// clause arena, because propagation reorders the literals of the clauses it
+// visits and learned clauses are private to each search.
+// Thread 0 runs the options given on the command line, the others cycle
+// through the configurations below with their own seed. One of them branches
+// on the static variable order, which can follow the structure of encodings
+// that number related variables together. Unless disabled, the threads
+// exchange short learned clauses (see share.c).
+
+typedef struct {
+    int decision_heuristic;
+    int polarity;
+    int restart_policy;
+    double activity_decay;
+} PortfolioConfig;
+
+static const PortfolioConfig portfolio_configs[] = {
+    {HEURISTIC_VSIDS, POLARITY_TARGET, RESTART_GLUCOSE, 0.95},
+    {HEURISTIC_VSIDS, POLARITY_SAVED, RESTART_LUBY, 0.95},
+    {HEURISTIC_VSIDS, POLARITY_BEST, RESTART_GLUCOSE, 0.90},
+    {HEURISTIC_VSIDS, POLARITY_FALSE, RESTART_LUBY, 0.95},
+    {HEURISTIC_STATIC, POLARITY_SAVED, RESTART_LUBY, 0.95},
+    {HEURISTIC_VSIDS, POLARITY_RANDOM, RESTART_GLUCOSE, 0.95},
+    {HEURISTIC_VSIDS, POLARITY_TRUE, RESTART_LUBY, 0.90},
+    {HEURISTIC_VSIDS, POLARITY_SAVED, RESTART_GLUCOSE, 0.80},
+};
+
+#define PORTFOLIO_CONFIGS ((int)(sizeof(portfolio_configs) / sizeof(portfolio_configs[0])))
+
+typedef struct {
+    int index;
+    Formula* shared;
+    SolverOptions options;
+    atomic_int* stop;
+    atomic_int* winner; //index of the first thread to finish, -1 while searching
+    ClauseExchange* exchange;
+    Formula* formula;
+    Assignment* assignment;
+    bool result;
+} PortfolioThread;
+
+// Options of thread index, derived from the options of the command line
+static SolverOptions thread_options(SolverOptions* base, int index) {
+    SolverOptions options = *base;
+    options.threads = 1;
+    if (index == 0) {
+        return options;
+    }
+    const PortfolioConfig* config = &portfolio_configs[(index - 1) % PORTFOLIO_CONFIGS];
+    options.decision_heuristic = config->decision_heuristic;
+    options.polarity = config->polarity;
+    options.restart_policy = config->restart_policy;
+    options.activity_decay = config->activity_decay;
+    options.seed = base->seed + 0x9E3779B97F4A7C15ULL * index;
+    return options;
+}
+
+// Threads past the first get a random initial variable order, so threads
+// sharing a configuration still search differently
+static void shuffle_order(Assignment* assignment) {
+    for (int var = 0; var < assignment->size; var++) {
+        assignment->activity[var] = (next_random(assignment) >> 11) * 0x1.0p-53 * 1e-3;
+    }
+    clear_heap(&assignment->order, assignment->size);
+    for (int var = 0; var < assignment->size; var++) {
+        heap_insert(&assignment->order, var);
+    }
+}
+
+static void* portfolio_thread(void* argument) {
+    PortfolioThread* thread = (PortfolioThread*)argument;
+    thread->formula = copy_formula(thread->shared);
+    thread->assignment = create_assignment(thread->formula->num_variables);
+    thread->assignment->options = thread->options;
+    thread->assignment->stop = thread->stop;
+    if (thread->exchange) {
+        join_exchange(thread->assignment, thread->exchange, thread->index);
+    }
+    if (thread->index > 0) {
+        thread->assignment->random_state = thread->options.seed;
+        shuffle_order(thread->assignment);
+    }
+
+    thread->result = solve(thread->formula, thread->assignment);
+
+    // the first thread to finish wins and stops the others
+    if (!thread->assignment->interrupted) {
+        int searching = -1;
+        if (atomic_compare_exchange_strong(thread->winner, &searching, thread->index)) {
+            atomic_store(thread->stop, 1);
+        }
+    }
+    return NULL;
+}
+
+// Solve formula with options->threads racing searches. Returns the assignment
+// of the winning thread (the model if *result is true), to be freed by the caller.
+// counters, if not NULL, receives the clause sharing totals.
+Assignment* solve_portfolio(Formula* formula, SolverOptions* options, bool* result, PhaseCounters* counters) {
+    int count = options->threads;
+    PortfolioThread* threads = (PortfolioThread*)calloc(count, sizeof(PortfolioThread));
+    pthread_t* handles = (pthread_t*)malloc(count * sizeof(pthread_t));
+    if (!threads || !handles) {
+        perror("Failed to allocate memory for portfolio threads");
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_int stop = 0;
+    atomic_int winner = -1;
+    ClauseExchange* exchange = options->share ? create_exchange(count) : NULL;
+    for (int i = 0; i < count; i++) {
+        threads[i].index = i;
+        threads[i].shared = formula;
+        threads[i].options = thread_options(options, i);
+        threads[i].stop = &stop;
+        threads[i].winner = &winner;
+        threads[i].exchange = exchange;
+        if (pthread_create(&handles[i], NULL, portfolio_thread, &threads[i]) != 0) {
+            perror("Failed to create portfolio thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(handles[i], NULL);
+    }
+
+    if (counters) {
+        counters->threads = count;
+        counters->shared = exchange != NULL;
+    }
+    for (int i = 0; i < count && exchange; i++) {
+        Assignment* a = threads[i].assignment;
+        if (options->stats == STATS_TEXT) {
+            fprintf(stderr, "c thread %d: exported %lld, imported %lld, used %lld, dropped %lld\n",
+                    i, a->shared_exported, a->shared_imported, a->shared_used, a->shared_dropped);
+        }
+        if (counters) {
+            counters->exported += a->shared_exported;
+            counters->imported += a->shared_imported;
+            counters->used += a->shared_used;
+            counters->dropped += a->shared_dropped;
+        }
+    }
+
+    int best = atomic_load(&winner);
+    if (best < 0) {
+        // every thread gave up (local search only), thread 0 reports it
+        best = 0;
+    }
+    Assignment* assignment = threads[best].assignment;
+    *result = threads[best].result;
+    for (int i = 0; i < count; i++) {
+        if (i != best) {
+            free_assignment(threads[i].assignment);
+        }
+        free_formula(threads[i].formula);
+    }
+    free_exchange(exchange);
+    free(threads);
+    free(handles);
+    return assignment;
+}
@@ -0,0 +1,683 @@
+#include "sat.h"
+
+// SatELite-style preprocessing, run on the parsed formula before the search:
+// - units are propagated at the root,
+// - clauses subsumed by another clause are removed (backward subsumption),
+// - self-subsuming resolution strengthens clauses: when C = (l, rest) and
+//   D contains ~l and rest, the resolvent on l subsumes D and ~l is dropped,
+// - bounded variable elimination replaces the clauses of a variable by
+//   their non-tautological resolvents when there are no more of those than
+//   of the clauses removed (and none longer than ELIM_RESOLVENT_SIZE).
+// Clauses are indexed by occurrence lists, one per literal. Removed clauses
+// are dropped from the lists lazily, when a list is visited.
+//
+// Eliminated variables no longer occur in the simplified formula. Their
+// clauses are kept on a reconstruction stack, and extend_model() gives
+// them values satisfying those clauses once the rest of the model is known,
+// so the model still covers every original variable.
+//
+// With a proof, resolvents and strengthened clauses are added as they are
+// made, root units as they are found, and removed clauses deleted; a clause
+// strengthened in place is added in its new form before the old one goes.
+
+typedef struct {
+    uint32_t start; //offset of the literals in the pool
+    int size;
+    bool removed;
+    bool queued; //waiting for backward subsumption
+    uint64_t signature; //one bit per variable modulo 64, for quick subset tests
+} OccClause;
+
+typedef struct {
+    int* clauses;
+    int size;
+    int capacity;
+} OccList;
+
+struct Preprocessor {
+    Lit* pool; //literals of every clause, strengthened clauses shrink in place
+    uint32_t pool_size;
+    uint32_t pool_capacity;
+    OccClause* clauses;
+    int num_clauses;
+    int capacity;
+    int num_variables;
+    int variables_capacity; //per-variable arrays have room for this many
+    OccList* occurs; //clauses of each literal, may still list removed clauses
+    int* live; //clauses of each literal that are not removed
+    signed char* value; //root value of each variable, PHASE_UNSET if free
+    bool* eliminated;
+    Lit* units; //root assignments whose clauses have not been visited yet
+    int units_head;
+    int units_size;
+    int* queue; //clauses to check for backward subsumption
+    int queue_size;
+    int queue_capacity;
+    int* marks; //per literal, stamp of the clause being compared
+    int stamp;
+    int* candidates;
+    int candidates_capacity;
+    Lit* resolvent;
+    bool unsatisfiable;
+    ReconstructionStack* stack;
+    Proof* proof; //NULL if there is no proof
+    int subsumed;
+    int strengthened;
+    int eliminated_count;
+    int fixed;
+    Assignment* roots; //level 0 assignment of probing
+};
+
+static void* grow(void* array, int* capacity, int needed, size_t element) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    array = realloc(array, new_capacity * element);
+    if (!array) {
+        perror("Failed to reallocate memory for preprocessing");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return array;
+}
+
+static Lit* clause_literals(Preprocessor* pp, int c) {
+    return pp->pool + pp->clauses[c].start;
+}
+
+static void compute_signature(Preprocessor* pp, int c) {
+    OccClause* clause = &pp->clauses[c];
+    Lit* literals = clause_literals(pp, c);
+    clause->signature = 0;
+    for (int i = 0; i < clause->size; i++) {
+        clause->signature |= 1ULL << (lit_var(literals[i]) & 63);
+    }
+}
+
+static void enqueue_clause(Preprocessor* pp, int c) {
+    if (pp->clauses[c].queued) {
+        return;
+    }
+    pp->queue = (int*)grow(pp->queue, &pp->queue_capacity, pp->queue_size + 1, sizeof(int));
+    pp->queue[pp->queue_size++] = c;
+    pp->clauses[c].queued = true;
+}
+
+static void assign_unit(Preprocessor* pp, Lit lit) {
+    int var = lit_var(lit);
+    if (pp->value[var] != PHASE_UNSET) {
+        if (pp->value[var] == lit_negated(lit)) {
+            pp->unsatisfiable = true;
+        }
+        return;
+    }
+    pp->value[var] = !lit_negated(lit);
+    pp->units[pp->units_size++] = lit;
+    pp->fixed++;
+}
+
+static void remove_clause(Preprocessor* pp, int c) {
+    OccClause* clause = &pp->clauses[c];
+    Lit* literals = clause_literals(pp, c);
+    if (pp->proof) {
+        proof_delete(pp->proof, literals, clause->size);
+    }
+    clause->removed = true;
+    for (int i = 0; i < clause->size; i++) {
+        pp->live[literals[i]]--;
+    }
+}
+
+// Log the clause add_occ_clause() keeps of literals: a derived clause is new
+// to the proof, a clause of the input is replaced if the root values change it
+static void log_occ_clause(Preprocessor* pp, const Lit* literals, int size, bool derived) {
+    bool satisfied = false;
+    int kept = 0;
+    for (int i = 0; i < size && !satisfied; i++) {
+        int value = pp->value[lit_var(literals[i])];
+        satisfied = value != PHASE_UNSET && value != lit_negated(literals[i]);
+        kept += value == PHASE_UNSET;
+    }
+    bool changed = satisfied || kept < size;
+    if (!satisfied && (derived || changed)) {
+        proof_begin(pp->proof, false);
+        for (int i = 0; i < size; i++) {
+            if (pp->value[lit_var(literals[i])] == PHASE_UNSET) {
+                proof_literal(pp->proof, literals[i]);
+            }
+        }
+        proof_end(pp->proof);
+    }
+    if (!derived && changed) {
+        proof_delete(pp->proof, literals, size);
+    }
+}
+
+// Add a clause, simplified by the root values: satisfied clauses are
+// dropped, false literals removed, units assigned. literals may be
+// pp->resolvent. derived tells a resolvent from a clause of the input.
+static void add_occ_clause(Preprocessor* pp, const Lit* literals, int size, bool derived) {
+    if (pp->proof) {
+        log_occ_clause(pp, literals, size, derived);
+    }
+    int kept = 0;
+    Lit* resolvent = pp->resolvent;
+    for (int i = 0; i < size; i++) {
+        int value = pp->value[lit_var(literals[i])];
+        if (value == PHASE_UNSET) {
+            resolvent[kept++] = literals[i];
+        } else if (value != lit_negated(literals[i])) {
+            return;
+        }
+    }
+    if (kept == 0) {
+        pp->unsatisfiable = true;
+        return;
+    }
+    if (kept == 1) {
+        assign_unit(pp, resolvent[0]);
+        return;
+    }
+
+    pp->clauses = (OccClause*)grow(pp->clauses, &pp->capacity, pp->num_clauses + 1, sizeof(OccClause));
+    int pool_capacity = pp->pool_capacity;
+    pp->pool = (Lit*)grow(pp->pool, &pool_capacity, pp->pool_size + kept, sizeof(Lit));
+    pp->pool_capacity = pool_capacity;
+
+    int c = pp->num_clauses++;
+    OccClause* clause = &pp->clauses[c];
+    clause->start = pp->pool_size;
+    clause->size = kept;
+    clause->removed = false;
+    clause->queued = false;
+    memcpy(pp->pool + pp->pool_size, resolvent, kept * sizeof(Lit));
+    pp->pool_size += kept;
+    compute_signature(pp, c);
+    for (int i = 0; i < kept; i++) {
+        OccList* list = &pp->occurs[resolvent[i]];
+        list->clauses = (int*)grow(list->clauses, &list->capacity, list->size + 1, sizeof(int));
+        list->clauses[list->size++] = c;
+        pp->live[resolvent[i]]++;
+    }
+    enqueue_clause(pp, c);
+}
+
+// Drop the removed clauses from the occurrence list of lit
+static OccList* compact_occurs(Preprocessor* pp, Lit lit) {
+    OccList* list = &pp->occurs[lit];
+    int j = 0;
+    for (int i = 0; i < list->size; i++) {
+        if (!pp->clauses[list->clauses[i]].removed) {
+            list->clauses[j++] = list->clauses[i];
+        }
+    }
+    list->size = j;
+    return list;
+}
+
+// Remove lit from clause c, which then gets checked for subsumption again
+static void strengthen(Preprocessor* pp, int c, Lit lit) {
+    OccClause* clause = &pp->clauses[c];
+    Lit* literals = clause_literals(pp, c);
+    int j = 0;
+    for (int i = 0; i < clause->size; i++) {
+        if (literals[i] != lit) {
+            literals[j++] = literals[i];
+        }
+    }
+    clause->size = j;
+    if (pp->proof) {
+        // the slot of the last literal is still the clause's
+        proof_add(pp->proof, literals, j);
+        literals[j] = lit;
+        proof_delete(pp->proof, literals, j + 1);
+    }
+    pp->live[lit]--;
+    OccList* list = &pp->occurs[lit];
+    for (int i = 0; i < list->size; i++) {
+        if (list->clauses[i] == c) {
+            list->clauses[i] = list->clauses[--list->size];
+            break;
+        }
+    }
+    if (clause->size == 1) {
+        assign_unit(pp, literals[0]);
+        remove_clause(pp, c);
+        return;
+    }
+    compute_signature(pp, c);
+    enqueue_clause(pp, c);
+}
+
+static void propagate_units(Preprocessor* pp) {
+    while (pp->units_head < pp->units_size && !pp->unsatisfiable) {
+        Lit lit = pp->units[pp->units_head++];
+        OccList* satisfied = compact_occurs(pp, lit);
+        for (int i = 0; i < satisfied->size; i++) {
+            remove_clause(pp, satisfied->clauses[i]);
+        }
+        satisfied->size = 0;
+        // strengthening removes the clause from the list being visited
+        OccList* falsified = compact_occurs(pp, lit_negate(lit));
+        while (falsified->size > 0 && !pp->unsatisfiable) {
+            strengthen(pp, falsified->clauses[falsified->size - 1], lit_negate(lit));
+        }
+    }
+}
+
+// Remove the clauses subsumed by clause c and strengthen those it
+// self-subsumes. Every such clause contains the variable of c with the
+// fewest occurrences, with one sign or the other.
+static void backward_subsume(Preprocessor* pp, int c) {
+    Lit* literals = clause_literals(pp, c);
+    int size = pp->clauses[c].size;
+    int best = lit_var(literals[0]);
+    for (int i = 1; i < size; i++) {
+        int var = lit_var(literals[i]);
+        if (pp->live[2 * var] + pp->live[2 * var + 1] < pp->live[2 * best] + pp->live[2 * best + 1]) {
+            best = var;
+        }
+    }
+    if (pp->live[2 * best] + pp->live[2 * best + 1] > SUBSUME_MAX_OCCURRENCES) {
+        return;
+    }
+
+    // the lists change while candidates are strengthened, so copy them first
+    int count = 0;
+    for (int sign = 0; sign <= 1; sign++) {
+        OccList* list = compact_occurs(pp, make_lit(best, sign));
+        pp->candidates = (int*)grow(pp->candidates, &pp->candidates_capacity, count + list->size, sizeof(int));
+        memcpy(pp->candidates + count, list->clauses, list->size * sizeof(int));
+        count += list->size;
+    }
+
+    pp->stamp++;
+    for (int i = 0; i < size; i++) {
+        pp->marks[literals[i]] = pp->stamp;
+    }
+    uint64_t signature = pp->clauses[c].signature;
+    for (int k = 0; k < count && !pp->clauses[c].removed; k++) {
+        int d = pp->candidates[k];
+        OccClause* other = &pp->clauses[d];
+        if (d == c || other->removed || other->size < size || (signature & ~other->signature) != 0) {
+            continue;
+        }
+        Lit* other_literals = clause_literals(pp, d);
+        int same = 0, flipped = 0;
+        Lit flip = 0;
+        for (int i = 0; i < other->size; i++) {
+            Lit lit = other_literals[i];
+            if (pp->marks[lit] == pp->stamp) {
+                same++;
+            } else if (pp->marks[lit_negate(lit)] == pp->stamp) {
+                flipped++;
+                flip = lit;
+            }
+        }
+        if (same == size) {
+            remove_clause(pp, d);
+            pp->subsumed++;
+        } else if (same == size - 1 && flipped == 1) {
+            strengthen(pp, d, flip);
+            pp->strengthened++;
+        }
+    }
+}
+
+static void run_subsumption(Preprocessor* pp) {
+    while ((pp->queue_size > 0 || pp->units_head < pp->units_size) && !pp->unsatisfiable) {
+        propagate_units(pp);
+        if (pp->queue_size == 0 || pp->unsatisfiable) {
+            continue;
+        }
+        int c = pp->queue[--pp->queue_size];
+        pp->clauses[c].queued = false;
+        if (!pp->clauses[c].removed) {
+            backward_subsume(pp, c);
+        }
+    }
+}
+
+// Resolve clauses c (containing the variable's positive literal) and d on
+// var into pp->resolvent. Returns its size, -1 if it is a tautology.
+static int resolve(Preprocessor* pp, int c, int d, int var) {
+    Lit* resolvent = pp->resolvent;
+    int size = 0;
+    pp->stamp++;
+    Lit* literals = clause_literals(pp, c);
+    for (int i = 0; i < pp->clauses[c].size; i++) {
+        if (lit_var(literals[i]) != var) {
+            pp->marks[literals[i]] = pp->stamp;
+            resolvent[size++] = literals[i];
+        }
+    }
+    literals = clause_literals(pp, d);
+    for (int i = 0; i < pp->clauses[d].size; i++) {
+        Lit lit = literals[i];
+        if (lit_var(lit) == var || pp->marks[lit] == pp->stamp) {
+            continue;
+        }
+        if (pp->marks[lit_negate(lit)] == pp->stamp) {
+            return -1;
+        }
+        resolvent[size++] = lit;
+    }
+    return size;
+}
+
+// Record a clause containing pivot that leaves the formula, so that
+// extend_model() can make it true by flipping the variable of pivot
+void push_reconstruction_clause(ReconstructionStack* stack, Lit pivot, const Lit* literals, int size) {
+    stack->literals = (Lit*)grow(stack->literals, &stack->capacity, stack->size + size + 1, sizeof(Lit));
+    stack->literals[stack->size++] = pivot;
+    for (int i = 0; i < size; i++) {
+        if (literals[i] != pivot) {
+            stack->literals[stack->size++] = literals[i];
+        }
+    }
+    stack->literals[stack->size++] = (Lit)size;
+}
+
+static void push_reconstruction(Preprocessor* pp, int c, Lit pivot) {
+    push_reconstruction_clause(pp->stack, pivot, clause_literals(pp, c), pp->clauses[c].size);
+}
+
+// Replace the clauses of var by their resolvents if that does not add clauses
+static bool eliminate_variable(Preprocessor* pp, int var) {
+    OccList* positive = compact_occurs(pp, make_lit(var, false));
+    OccList* negative = compact_occurs(pp, make_lit(var, true));
+    int removed = positive->size + negative->size;
+    if (removed == 0 || (positive->size > 0 && negative->size > 0 && removed > ELIM_MAX_OCCURRENCES)) {
+        return false;
+    }
+
+    int resolvents = 0;
+    for (int i = 0; i < positive->size; i++) {
+        for (int j = 0; j < negative->size; j++) {
+            int size = resolve(pp, positive->clauses[i], negative->clauses[j], var);
+            if (size > ELIM_RESOLVENT_SIZE) {
+                return false;
+            }
+            if (size >= 0 && ++resolvents > removed + ELIM_GROWTH) {
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < positive->size; i++) {
+        push_reconstruction(pp, positive->clauses[i], make_lit(var, false));
+    }
+    for (int i = 0; i < negative->size; i++) {
+        push_reconstruction(pp, negative->clauses[i], make_lit(var, true));
+    }
+    // adding resolvents may move the occurrence arrays of other literals,
+    // never those of var
+    for (int i = 0; i < positive->size; i++) {
+        for (int j = 0; j < negative->size; j++) {
+            int size = resolve(pp, positive->clauses[i], negative->clauses[j], var);
+            if (size >= 0) {
+                add_occ_clause(pp, pp->resolvent, size, true);
+            }
+        }
+    }
+    for (int i = 0; i < positive->size; i++) {
+        remove_clause(pp, positive->clauses[i]);
+    }
+    for (int i = 0; i < negative->size; i++) {
+        remove_clause(pp, negative->clauses[i]);
+    }
+    positive->size = 0;
+    negative->size = 0;
+    pp->eliminated[var] = true;
+    pp->eliminated_count++;
+    return true;
+}
+
+static Preprocessor* create_preprocessor(int n) {
+    Preprocessor* pp = (Preprocessor*)calloc(1, sizeof(Preprocessor));
+    if (!pp) {
+        perror("Failed to allocate memory for preprocessing");
+        exit(EXIT_FAILURE);
+    }
+    pp->variables_capacity = n;
+    pp->occurs = (OccList*)calloc(2 * n + 2, sizeof(OccList));
+    pp->live = (int*)calloc(2 * n + 2, sizeof(int));
+    pp->marks = (int*)calloc(2 * n + 2, sizeof(int));
+    pp->value = (signed char*)malloc(n + 1);
+    pp->eliminated = (bool*)calloc(n + 1, sizeof(bool));
+    pp->units = (Lit*)malloc((n + 1) * sizeof(Lit));
+    pp->resolvent = (Lit*)malloc((n + 1) * sizeof(Lit));
+    if (!pp->occurs || !pp->live || !pp->marks || !pp->value || !pp->eliminated || !pp->units || !pp->resolvent) {
+        perror("Failed to allocate memory for preprocessing");
+        exit(EXIT_FAILURE);
+    }
+    return pp;
+}
+
+// Ready a preprocessor for formula, reusing the one in workspace unless it
+// is NULL or made for fewer variables. The clause pool, the occurrence lists
+// and the rest keep their memory, so only a larger formula allocates.
+static Preprocessor* preprocessor_for(Formula* formula, ReconstructionStack* stack, Preprocessor* workspace) {
+    int n = formula->num_variables;
+    Preprocessor* pp = workspace;
+    if (!pp || n > pp->variables_capacity) {
+        if (pp) {
+            free_preprocessor(pp);
+        }
+        pp = create_preprocessor(n);
+    }
+    for (int i = 0; i < 2 * n; i++) {
+        pp->occurs[i].size = 0;
+    }
+    memset(pp->live, 0, 2 * n * sizeof(int));
+    memset(pp->value, PHASE_UNSET, n + 1);
+    memset(pp->eliminated, 0, (n + 1) * sizeof(bool));
+    pp->num_variables = n;
+    pp->num_clauses = 0;
+    pp->pool_size = 0;
+    pp->units_head = 0;
+    pp->units_size = 0;
+    pp->queue_size = 0;
+    pp->unsatisfiable = false;
+    pp->subsumed = 0;
+    pp->strengthened = 0;
+    pp->eliminated_count = 0;
+    pp->fixed = 0;
+    pp->stack = stack;
+    pp->proof = formula->proof;
+    return pp;
+}
+
+void free_preprocessor(Preprocessor* pp) {
+    if (!pp) return;
+    for (int i = 0; i < 2 * pp->variables_capacity; i++) {
+        free(pp->occurs[i].clauses);
+    }
+    free(pp->occurs);
+    free(pp->live);
+    free(pp->marks);
+    free(pp->value);
+    free(pp->eliminated);
+    free(pp->units);
+    free(pp->resolvent);
+    free(pp->pool);
+    free(pp->clauses);
+    free(pp->queue);
+    free(pp->candidates);
+    if (pp->roots) {
+        free_assignment(pp->roots);
+    }
+    free(pp);
+}
+
+typedef struct {
+    long long cost; //product of the occurrences of both literals
+    int var;
+} EliminationCandidate;
+
+// Variables with few occurrences are cheap and likely to be eliminated
+static int compare_candidates(const void* a, const void* b) {
+    const EliminationCandidate* x = (const EliminationCandidate*)a;
+    const EliminationCandidate* y = (const EliminationCandidate*)b;
+    if (x->cost != y->cost) {
+        return (x->cost > y->cost) - (x->cost < y->cost);
+    }
+    return x->var - y->var;
+}
+
+// Simplify formula, which is freed, and return the equisatisfiable result
+// over the same variables. stack receives what extend_model() needs. With
+// probe, failed literals and equivalent literals are dealt with first.
+// counters, if not NULL, receives what was removed for the statistics.
+Formula* preprocess_formula(Formula* formula, ReconstructionStack* stack, bool probe, PhaseCounters* counters) {
+    Preprocessor* pp = NULL;
+    Formula* simplified = preprocess_formula_into(formula, stack, probe, counters, &pp, NULL);
+    free_preprocessor(pp);
+    free_formula(formula);
+    return simplified;
+}
+
+// The same, for callers simplifying formula after formula (see batch.c):
+// formula is kept (probing may still rewrite it), the preprocessor in
+// *workspace is reused and left there for the next call, and the result is
+// written into recycled, which is cleared first, unless it is NULL.
+Formula* preprocess_formula_into(Formula* formula, ReconstructionStack* stack, bool probe, PhaseCounters* counters,
+                                 Preprocessor** workspace, Formula* recycled) {
+    int original_clauses = formula->size;
+    Preprocessor* pp = preprocessor_for(formula, stack, *workspace);
+    *workspace = pp;
+
+    if (probe) {
+        double start = stats_clock();
+        pp->roots = recycle_assignment(pp->roots, formula->num_variables);
+        Assignment* roots = pp->roots;
+        int substituted;
+        if (!probe_formula(formula, roots, stack, &substituted)) {
+            pp->unsatisfiable = true;
+        }
+        if (counters) {
+            counters->probed = true;
+            counters->failed_literals = roots->failed_literals;
+            counters->implied_literals = roots->implied_literals;
+            counters->substituted = substituted;
+            counters->probe_seconds = stats_clock() - start;
+        }
+        for (int i = 0; i < roots->trail_size; i++) {
+            // propagated units become clauses of the proof, as the clauses
+            // that implied them may be deleted as satisfied
+            if (pp->proof) {
+                proof_add(pp->proof, &roots->trail[i], 1);
+            }
+            assign_unit(pp, roots->trail[i]);
+        }
+    }
+
+    for (int i = 0; i < formula->size && !pp->unsatisfiable; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        // the input may repeat a literal or hold tautologies
+        pp->stamp++;
+        int size = 0;
+        bool tautology = false;
+        for (int j = 0; j < (int)clause->size; j++) {
+            Lit lit = clause->literals[j];
+            if (pp->marks[lit_negate(lit)] == pp->stamp) {
+                tautology = true;
+            } else if (pp->marks[lit] != pp->stamp) {
+                pp->marks[lit] = pp->stamp;
+                pp->resolvent[size++] = lit;
+            }
+        }
+        if (!tautology) {
+            add_occ_clause(pp, pp->resolvent, size, false);
+        }
+    }
+    run_subsumption(pp);
+
+    int num_variables = formula->num_variables;
+    EliminationCandidate* order = (EliminationCandidate*)malloc((num_variables + 1) * sizeof(EliminationCandidate));
+    if (!order) {
+        perror("Failed to allocate memory for preprocessing");
+        exit(EXIT_FAILURE);
+    }
+    for (int var = 0; var < num_variables; var++) {
+        order[var].cost = (long long)pp->live[2 * var] * pp->live[2 * var + 1];
+        order[var].var = var;
+    }
+    qsort(order, num_variables, sizeof(EliminationCandidate), compare_candidates);
+    for (int i = 0; i < num_variables && !pp->unsatisfiable; i++) {
+        int var = order[i].var;
+        if (pp->value[var] == PHASE_UNSET && !pp->eliminated[var] && eliminate_variable(pp, var)) {
+            run_subsumption(pp);
+        }
+    }
+    free(order);
+
+    // the simplified formula: root values as units, then the remaining clauses
+    Formula* simplified = recycled;
+    if (simplified) {
+        clear_formula(simplified);
+    } else {
+        simplified = create_formula();
+    }
+    if (pp->unsatisfiable) {
+        add_original_clause(simplified, NULL, 0);
+    } else {
+        for (int var = 0; var < num_variables; var++) {
+            if (pp->value[var] != PHASE_UNSET) {
+                Lit lit = make_lit(var, !pp->value[var]);
+                add_original_clause(simplified, &lit, 1);
+            }
+        }
+        for (int c = 0; c < pp->num_clauses; c++) {
+            if (!pp->clauses[c].removed) {
+                add_original_clause(simplified, clause_literals(pp, c), pp->clauses[c].size);
+            }
+        }
+    }
+    simplified->num_variables = num_variables;
+    simplified->proof = formula->proof;
+
+    if (counters) {
+        counters->preprocessed = true;
+        counters->clauses_before = original_clauses;
+        counters->clauses_removed = original_clauses - simplified->size;
+        counters->eliminated = pp->eliminated_count;
+        counters->fixed = pp->fixed;
+        counters->subsumed = pp->subsumed;
+        counters->strengthened = pp->strengthened;
+    }
+    return simplified;
+}
+
+// Give the eliminated variables values that satisfy their removed clauses.
+// The stack is read backwards: a variable eliminated earlier never occurs in
+// the clauses removed for one eliminated later, while the clauses removed
+// for an earlier variable may mention later ones, so those are decided first.
+void extend_model(ReconstructionStack* stack, Assignment* assignment) {
+    int end = stack->size;
+    while (end > 0) {
+        int size = (int)stack->literals[end - 1];
+        Lit* literals = stack->literals + end - 1 - size;
+        end -= size + 1;
+        bool satisfied = false;
+        for (int i = 0; i < size && !satisfied; i++) {
+            satisfied = literal_value(assignment, literals[i]) == LITERAL_TRUE;
+        }
+        if (!satisfied) {
+            // the eliminated literal comes first
+            assignment->values[literals[0]] = LITERAL_TRUE;
+            assignment->values[lit_negate(literals[0])] = LITERAL_FALSE;
+        }
+    }
+}
+
+void free_reconstruction(ReconstructionStack* stack) {
+    free(stack->literals);
+    stack->literals = NULL;
+    stack->size = 0;
+    stack->capacity = 0;
+}
@@ -0,0 +1,490 @@
+#include "sat.h"
+
+// Failed-literal probing and equivalent-literal substitution.
+//
+// Probing runs at level 0 with the solver's own watches and propagation:
+// both values of a candidate variable are propagated on a temporary level.
+// If one of them conflicts its complement holds in every model and is
+// assigned at level 0; literals implied by both values are assigned as well.
+// Candidates are the variables of binary clauses, roots of the binary
+// implication graph (literals that nothing implies) first, as propagating
+// them reaches the most implications. Rounds run before the search (see
+// preprocess.c, or probe_search_formula without preprocessing) and at
+// restarts, each within a budget of propagations, the restart rounds
+// resuming where the previous one stopped.
+//
+// Equivalent literals are the strongly connected components of the binary
+// implication graph. Before the search every literal is replaced by the
+// representative of its component throughout the original clauses, and the
+// substituted variables get their values back through the reconstruction
+// stack once a model is found.
+
+static void* grow_array(void* array, int* capacity, int needed, size_t element) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    array = realloc(array, new_capacity * element);
+    if (!array) {
+        perror("Failed to reallocate memory for equivalent literals");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return array;
+}
+
+// A binary clause with both literals free at level 0
+static bool free_binary(StoredClause* clause, Assignment* assignment) {
+    return clause->size == 2 && !clause->deleted
+        && literal_value(assignment, clause->literals[0]) == LITERAL_UNASSIGNED
+        && literal_value(assignment, clause->literals[1]) == LITERAL_UNASSIGNED;
+}
+
+// Number of free binary clauses, original or learned, each literal occurs in
+static void count_binary_occurrences(Formula* formula, Assignment* assignment, int* count) {
+    for (int pass = 0; pass < 2; pass++) {
+        ClauseRef* refs = pass == 0 ? formula->clauses : formula->learned;
+        int size = pass == 0 ? formula->size : formula->num_learned;
+        for (int i = 0; i < size; i++) {
+            StoredClause* clause = clause_at(formula, refs[i]);
+            if (!free_binary(clause, assignment)) {
+                continue;
+            }
+            count[clause->literals[0]]++;
+            count[clause->literals[1]]++;
+        }
+    }
+}
+
+// Variables worth probing, those with a root literal first. Returns how many.
+static int select_probes(Formula* formula, Assignment* assignment, int* candidates) {
+    int* count = (int*)calloc(2 * assignment->size, sizeof(int));
+    if (!count) {
+        perror("Failed to allocate memory for probing");
+        exit(EXIT_FAILURE);
+    }
+    count_binary_occurrences(formula, assignment, count);
+    // a literal is a root if it occurs in no binary clause while its complement does
+    int roots = 0, size = 0;
+    for (int var = 0; var < assignment->size; var++) {
+        int positive = count[2 * var], negative = count[2 * var + 1];
+        if (variable_assigned(assignment, var) || positive + negative == 0) {
+            continue;
+        }
+        candidates[size++] = var;
+        if (positive == 0 || negative == 0) {
+            candidates[size - 1] = candidates[roots];
+            candidates[roots++] = var;
+        }
+    }
+    free(count);
+    return size;
+}
+
+// Propagate lit on a new level above level 0. Returns false on a conflict.
+// The implied literals stay on the trail until the caller backtracks.
+static bool propagate_probe(Formula* formula, Assignment* assignment, Lit lit) {
+    ClauseRef conflict;
+    new_decision_level(assignment);
+    assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+    return unit_propagation(formula, assignment, &conflict) != UIP_CONFLICT;
+}
+
+// Assign lit at level 0 and propagate it. Returns false if the formula is refuted.
+static bool assign_root(Formula* formula, Assignment* assignment, Lit lit) {
+    ClauseRef conflict;
+    if (literal_value(assignment, lit) != LITERAL_UNASSIGNED) {
+        return literal_value(assignment, lit) == LITERAL_TRUE;
+    }
+    if (formula->proof) {
+        proof_add(formula->proof, &lit, 1);
+    }
+    assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+    if (assignment->exchange) {
+        export_clause(assignment, &lit, 1, 1);
+    }
+    return unit_propagation(formula, assignment, &conflict) != UIP_CONFLICT;
+}
+
+// One probing round at level 0, after full propagation, spending about
+// budget propagations. Returns false if the formula is refuted.
+bool probe_failed_literals(Formula* formula, Assignment* assignment, long long budget) {
+    int n = assignment->size;
+    int* candidates = (int*)malloc((n + 1) * sizeof(int));
+    int* marks = (int*)calloc(2 * n, sizeof(int));
+    Lit* implied = (Lit*)malloc((n + 1) * sizeof(Lit));
+    bool* phases = (bool*)malloc((n + 1) * sizeof(bool));
+    if (!candidates || !marks || !implied || !phases) {
+        perror("Failed to allocate memory for probing");
+        exit(EXIT_FAILURE);
+    }
+    // probes overwrite the saved phases of what they propagate
+    memcpy(phases, assignment->saved_phase, n * sizeof(bool));
+
+    bool consistent = true;
+    int count = select_probes(formula, assignment, candidates);
+    long long limit = assignment->propagations + budget;
+    int probed = 0;
+    for (; probed < count && consistent && assignment->propagations < limit; probed++) {
+        int var = candidates[(assignment->probe_cursor + probed) % count];
+        if (variable_assigned(assignment, var)) {
+            continue;
+        }
+        Lit positive = make_lit(var, false);
+        int stamp = probed + 1;
+        if (!propagate_probe(formula, assignment, positive)) {
+            backtrack_assignment(assignment, 0);
+            assignment->failed_literals++;
+            consistent = assign_root(formula, assignment, lit_negate(positive));
+            continue;
+        }
+        for (int i = assignment->trail_lim[0]; i < assignment->trail_size; i++) {
+            marks[assignment->trail[i]] = stamp;
+        }
+        backtrack_assignment(assignment, 0);
+
+        if (!propagate_probe(formula, assignment, lit_negate(positive))) {
+            backtrack_assignment(assignment, 0);
+            assignment->failed_literals++;
+            consistent = assign_root(formula, assignment, positive);
+            continue;
+        }
+        int both = 0;
+        for (int i = assignment->trail_lim[0]; i < assignment->trail_size; i++) {
+            if (marks[assignment->trail[i]] == stamp) {
+                implied[both++] = assignment->trail[i];
+            }
+        }
+        backtrack_assignment(assignment, 0);
+        for (int i = 0; i < both && consistent; i++) {
+            // the unit is not implied by propagation alone, but is once the
+            // proof holds the clause (~positive implied), which is implied
+            // because positive propagates to implied
+            Lit reason[2] = {lit_negate(positive), implied[i]};
+            bool logged = formula->proof && literal_value(assignment, implied[i]) == LITERAL_UNASSIGNED;
+            if (literal_value(assignment, implied[i]) == LITERAL_UNASSIGNED) {
+                assignment->implied_literals++;
+            }
+            if (logged) {
+                proof_add(formula->proof, reason, 2);
+            }
+            consistent = assign_root(formula, assignment, implied[i]);
+            if (logged) {
+                proof_delete(formula->proof, reason, 2);
+            }
+        }
+    }
+    if (count > 0) {
+        assignment->probe_cursor = (assignment->probe_cursor + probed) % count;
+    }
+
+    for (int var = 0; var < n; var++) {
+        if (!variable_assigned(assignment, var)) {
+            assignment->saved_phase[var] = phases[var];
+        }
+    }
+    free(candidates);
+    free(marks);
+    free(implied);
+    free(phases);
+    return consistent;
+}
+
+// Map every literal to the representative of its strongly connected
+// component in the binary implication graph: the literal of the component
+// with the smallest variable. The components of lit and ~lit mirror each
+// other, so representative[~lit] == ~representative[lit] unless both are in
+// one component, which makes the formula unsatisfiable.
+static void find_equivalences(Formula* formula, Assignment* assignment, Lit* representative) {
+    int nodes = 2 * assignment->size;
+    int* start = (int*)calloc(nodes + 1, sizeof(int));
+    int* index = (int*)malloc(nodes * sizeof(int));
+    int* lowlink = (int*)malloc(nodes * sizeof(int));
+    int* edge = (int*)malloc(nodes * sizeof(int)); //next edge to visit of a node on the call stack
+    Lit* calls = (Lit*)malloc(nodes * sizeof(Lit));
+    Lit* component = (Lit*)malloc(nodes * sizeof(Lit));
+    bool* on_stack = (bool*)calloc(nodes, sizeof(bool));
+    if (!start || !index || !lowlink || !edge || !calls || !component || !on_stack) {
+        perror("Failed to allocate memory for equivalent literals");
+        exit(EXIT_FAILURE);
+    }
+
+    // adjacency arrays of the original clauses: clause (a b) gives the
+    // implications ~a -> b and ~b -> a
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        if (free_binary(clause, assignment)) {
+            start[lit_negate(clause->literals[0]) + 1]++;
+            start[lit_negate(clause->literals[1]) + 1]++;
+        }
+    }
+    for (int lit = 1; lit <= nodes; lit++) {
+        start[lit] += start[lit - 1];
+    }
+    int* targets = (int*)malloc((start[nodes] + 1) * sizeof(int));
+    int* fill = (int*)malloc(nodes * sizeof(int));
+    if (!targets || !fill) {
+        perror("Failed to allocate memory for equivalent literals");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(fill, start, nodes * sizeof(int));
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        if (!free_binary(clause, assignment)) {
+            continue;
+        }
+        Lit a = clause->literals[0], b = clause->literals[1];
+        targets[fill[lit_negate(a)]++] = b;
+        targets[fill[lit_negate(b)]++] = a;
+    }
+    free(fill);
+
+    // Tarjan's algorithm with an explicit call stack
+    for (int lit = 0; lit < nodes; lit++) {
+        index[lit] = -1;
+        representative[lit] = lit;
+    }
+    int next_index = 0, stack_size = 0;
+    for (int root = 0; root < nodes; root++) {
+        if (index[root] >= 0 || start[root] == start[root + 1]) {
+            continue;
+        }
+        int depth = 0;
+        calls[depth++] = root;
+        index[root] = lowlink[root] = next_index++;
+        edge[root] = start[root];
+        component[stack_size++] = root;
+        on_stack[root] = true;
+        while (depth > 0) {
+            Lit lit = calls[depth - 1];
+            if (edge[lit] < start[lit + 1]) {
+                Lit next = targets[edge[lit]++];
+                if (index[next] < 0) {
+                    index[next] = lowlink[next] = next_index++;
+                    edge[next] = start[next];
+                    component[stack_size++] = next;
+                    on_stack[next] = true;
+                    calls[depth++] = next;
+                } else if (on_stack[next] && index[next] < lowlink[lit]) {
+                    lowlink[lit] = index[next];
+                }
+                continue;
+            }
+            depth--;
+            if (depth > 0 && lowlink[lit] < lowlink[calls[depth - 1]]) {
+                lowlink[calls[depth - 1]] = lowlink[lit];
+            }
+            if (lowlink[lit] != index[lit]) {
+                continue;
+            }
+            // lit is the root of a component: pop it and pick its smallest literal
+            int first = stack_size;
+            Lit smallest = lit;
+            do {
+                Lit member = component[--first];
+                on_stack[member] = false;
+                if (member < smallest) {
+                    smallest = member;
+                }
+            } while (component[first] != lit);
+            for (int i = first; i < stack_size; i++) {
+                representative[component[i]] = smallest;
+            }
+            stack_size = first;
+        }
+    }
+
+    free(start);
+    free(index);
+    free(lowlink);
+    free(edge);
+    free(calls);
+    free(component);
+    free(on_stack);
+    free(targets);
+}
+
+// Replace equivalent literals by their representative in the original
+// clauses, which must have no learned clauses beside them. Clauses are
+// also simplified by the level 0 assignment (satisfied ones are deleted,
+// so the formula only stands together with that assignment), and those
+// that become units are assigned and propagated. Returns false if the
+// formula is refuted. *substituted receives the number of variables replaced.
+//
+// With a proof, every rewritten clause is added before any clause is deleted:
+// it follows by propagation over the binary clauses that make literals
+// equivalent, which may themselves be rewritten or deleted.
+bool substitute_equivalences(Formula* formula, Assignment* assignment, ReconstructionStack* stack, int* substituted) {
+    int nodes = 2 * assignment->size;
+    Lit* representative = (Lit*)malloc((nodes + 1) * sizeof(Lit));
+    int* marks = (int*)calloc(nodes, sizeof(int));
+    if (!representative || !marks) {
+        perror("Failed to allocate memory for equivalent literals");
+        exit(EXIT_FAILURE);
+    }
+    // with a proof: the original literals of the clause being rewritten, and
+    // those of every rewritten clause, each followed by its size
+    Lit* original = NULL;
+    int original_capacity = 0;
+    Lit* replaced = NULL;
+    int replaced_size = 0, replaced_capacity = 0;
+    ClauseRef* satisfied_refs = NULL;
+    int num_satisfied = 0;
+    if (formula->proof) {
+        satisfied_refs = (ClauseRef*)malloc((formula->size + 1) * sizeof(ClauseRef));
+        if (!satisfied_refs) {
+            perror("Failed to allocate memory for equivalent literals");
+            exit(EXIT_FAILURE);
+        }
+    }
+    find_equivalences(formula, assignment, representative);
+
+    *substituted = 0;
+    bool consistent = true;
+    for (int var = 0; var < assignment->size && consistent; var++) {
+        Lit lit = make_lit(var, false);
+        if (representative[lit] == lit) {
+            continue;
+        }
+        if (representative[lit] == representative[lit_negate(lit)]) {
+            // lit implies ~lit, so ~lit holds, and it implies lit
+            if (formula->proof) {
+                Lit unit = lit_negate(lit);
+                proof_add(formula->proof, &unit, 1);
+            }
+            consistent = false;
+            break;
+        }
+        // lit == r is the clauses (lit ~r) and (~lit r)
+        Lit r = representative[lit];
+        Lit clause[2] = {lit, lit_negate(r)};
+        push_reconstruction_clause(stack, lit, clause, 2);
+        clause[0] = lit_negate(lit);
+        clause[1] = r;
+        push_reconstruction_clause(stack, lit_negate(lit), clause, 2);
+        (*substituted)++;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < formula->size && consistent; i++) {
+        ClauseRef ref = formula->clauses[i];
+        StoredClause* clause = clause_at(formula, ref);
+        int size = 0;
+        bool satisfied = false;
+        if (formula->proof) {
+            original = (Lit*)grow_array(original, &original_capacity, clause->size, sizeof(Lit));
+            memcpy(original, clause->literals, clause->size * sizeof(Lit));
+        }
+        for (int j = 0; j < (int)clause->size && !satisfied; j++) {
+            Lit lit = representative[clause->literals[j]];
+            int value = literal_value(assignment, lit);
+            if (value == LITERAL_TRUE || marks[lit_negate(lit)] == i + 1) {
+                satisfied = true;
+            } else if (value == LITERAL_UNASSIGNED && marks[lit] != i + 1) {
+                marks[lit] = i + 1;
+                clause->literals[size++] = lit;
+            }
+        }
+        if (satisfied && formula->proof) {
+            // deleted with its original literals once every rewritten clause is in the proof
+            memcpy(clause->literals, original, clause->size * sizeof(Lit));
+            satisfied_refs[num_satisfied++] = ref;
+            continue;
+        }
+        if (satisfied) {
+            delete_clause(formula, ref);
+            continue;
+        }
+        if (formula->proof && (size < (int)clause->size || memcmp(original, clause->literals, size * sizeof(Lit)) != 0)) {
+            proof_add(formula->proof, clause->literals, size);
+            replaced = (Lit*)grow_array(replaced, &replaced_capacity, replaced_size + clause->size + 1, sizeof(Lit));
+            memcpy(replaced + replaced_size, original, clause->size * sizeof(Lit));
+            replaced_size += clause->size;
+            replaced[replaced_size++] = (Lit)clause->size;
+        }
+        formula->arena.wasted += clause->size - size;
+        clause->size = size;
+        formula->clauses[kept++] = ref;
+        if (size == 0) {
+            consistent = false;
+        } else if (size == 1) {
+            assign_literal(assignment, clause->literals[0], ref);
+        }
+    }
+    if (consistent) {
+        // the units among the kept clauses are assigned above
+        formula->size = kept;
+        assignment->units_checked = kept;
+    }
+    if (consistent && formula->proof) {
+        for (int end = replaced_size; end > 0;) {
+            int size = (int)replaced[end - 1];
+            end -= size + 1;
+            proof_delete(formula->proof, replaced + end, size);
+        }
+        for (int i = 0; i < num_satisfied; i++) {
+            delete_clause(formula, satisfied_refs[i]);
+        }
+    }
+
+    free(original);
+    free(replaced);
+    free(satisfied_refs);
+    free(representative);
+    free(marks);
+    if (!consistent) {
+        return false;
+    }
+    ClauseRef conflict;
+    rebuild_watches(formula);
+    return unit_propagation(formula, assignment, &conflict) != UIP_CONFLICT;
+}
+
+// Probing before the search: propagate the units of formula on assignment,
+// which must be fresh, probe, then substitute equivalent literals. The level
+// 0 assignment is left on assignment, with its probing counters, and the
+// number of substituted literals in *substituted. Returns false if the
+// formula is refuted.
+bool probe_formula(Formula* formula, Assignment* assignment, ReconstructionStack* stack, int* substituted) {
+    ClauseRef conflict;
+    *substituted = 0;
+    init_watches(formula);
+    return assign_unit_clauses(formula, assignment)
+        && unit_propagation(formula, assignment, &conflict) != UIP_CONFLICT
+        && probe_failed_literals(formula, assignment, PROBE_INITIAL_EFFORT)
+        && substitute_equivalences(formula, assignment, stack, substituted);
+}
+
+// Probing before a search without preprocessing: the level 0 assignment is
+// added to formula as unit clauses, or the empty clause if formula is
+// refuted, so that whichever search follows starts from it. counters, if
+// not NULL, receives the probing statistics.
+void probe_search_formula(Formula* formula, ReconstructionStack* stack, PhaseCounters* counters) {
+    double start = stats_clock();
+    Assignment* roots = create_assignment(formula->num_variables);
+    int substituted;
+    bool consistent = probe_formula(formula, roots, stack, &substituted);
+    if (counters) {
+        counters->probed = true;
+        counters->failed_literals = roots->failed_literals;
+        counters->implied_literals = roots->implied_literals;
+        counters->substituted = substituted;
+        counters->probe_seconds = stats_clock() - start;
+    }
+    if (!consistent) {
+        add_original_clause(formula, NULL, 0);
+    } else {
+        // units may be implied by clauses that substitution deleted as
+        // satisfied, so they become clauses of the proof as well
+        for (int i = 0; i < roots->trail_size; i++) {
+            if (formula->proof) {
+                proof_add(formula->proof, &roots->trail[i], 1);
+            }
+            add_original_clause(formula, &roots->trail[i], 1);
+        }
+    }
+    free_assignment(roots);
+}
@@ -0,0 +1,143 @@
+#include "sat.h"
+
+// DRAT proof logging (--proof). Every clause the solver derives is written
+// as an addition and every clause it drops as a deletion, so that a checker
+// replaying the proof against the input formula reaches the empty clause
+// when the answer is UNSAT. Each added clause is implied by unit propagation
+// (RUP) from the clauses present at that point: learned clauses, strengthened
+// and resolved clauses of preprocessing, units found by probing and clauses
+// rewritten with equivalent literals.
+//
+// The binary format writes 'a' or 'd', then every literal as the variable
+// length encoding of 2 * variable + sign (DIMACS numbering), then a 0 byte;
+// the text format writes DIMACS clauses, deletions prefixed with "d".
+// Everything goes through a PROOF_BUFFER buffer, so logging costs a few
+// stores per literal and one write per few megabytes.
+//
+// Unit clauses are never deleted: checkers ignore such deletions, as the
+// assignment they have propagated stays.
+
+Proof* open_proof(const char* filename, bool binary) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        perror("Failed to open the proof file");
+        return NULL;
+    }
+    Proof* proof = (Proof*)malloc(sizeof(Proof));
+    unsigned char* buffer = (unsigned char*)malloc(PROOF_BUFFER);
+    if (!proof || !buffer) {
+        perror("Failed to allocate memory for the proof");
+        exit(EXIT_FAILURE);
+    }
+    proof->file = file;
+    proof->buffer = buffer;
+    proof->size = 0;
+    proof->binary = binary;
+    proof->failed = false;
+    proof->added = 0;
+    proof->deleted = 0;
+    return proof;
+}
+
+static void flush_proof(Proof* proof) {
+    if (proof->size > 0 && fwrite(proof->buffer, 1, proof->size, proof->file) != proof->size) {
+        proof->failed = true;
+    }
+    proof->size = 0;
+}
+
+// Flush and close the proof, false if any of it could not be written
+bool close_proof(Proof* proof) {
+    flush_proof(proof);
+    if (fclose(proof->file) != 0) {
+        proof->failed = true;
+    }
+    bool written = !proof->failed;
+    if (!written) {
+        fprintf(stderr, "Failed to write the proof, it is incomplete\n");
+    }
+    free(proof->buffer);
+    free(proof);
+    return written;
+}
+
+// Room for the longest item: a literal, or a "d " prefix or end of clause
+static void reserve(Proof* proof) {
+    if (proof->size + 16 > PROOF_BUFFER) {
+        flush_proof(proof);
+    }
+}
+
+void proof_begin(Proof* proof, bool deletion) {
+    reserve(proof);
+    if (proof->binary) {
+        proof->buffer[proof->size++] = deletion ? 'd' : 'a';
+    } else if (deletion) {
+        proof->buffer[proof->size++] = 'd';
+        proof->buffer[proof->size++] = ' ';
+    }
+    if (deletion) {
+        proof->deleted++;
+    } else {
+        proof->added++;
+    }
+}
+
+void proof_literal(Proof* proof, Lit lit) {
+    reserve(proof);
+    unsigned char* out = proof->buffer + proof->size;
+    if (proof->binary) {
+        // 2 * variable + sign with 1-based variables
+        uint32_t code = lit + 2;
+        while (code > 127) {
+            *out++ = (unsigned char)(code | 128);
+            code >>= 7;
+        }
+        *out++ = (unsigned char)code;
+    } else {
+        char digits[12];
+        int n = 0;
+        uint32_t var = lit_var(lit) + 1;
+        do {
+            digits[n++] = '0' + var % 10;
+            var /= 10;
+        } while (var > 0);
+        if (lit_negated(lit)) {
+            *out++ = '-';
+        }
+        while (n > 0) {
+            *out++ = digits[--n];
+        }
+        *out++ = ' ';
+    }
+    proof->size = out - proof->buffer;
+}
+
+void proof_end(Proof* proof) {
+    reserve(proof);
+    if (proof->binary) {
+        proof->buffer[proof->size++] = 0;
+    } else {
+        proof->buffer[proof->size++] = '0';
+        proof->buffer[proof->size++] = '\n';
+    }
+}
+
+void proof_add(Proof* proof, const Lit* literals, int size) {
+    proof_begin(proof, false);
+    for (int i = 0; i < size; i++) {
+        proof_literal(proof, literals[i]);
+    }
+    proof_end(proof);
+}
+
+void proof_delete(Proof* proof, const Lit* literals, int size) {
+    if (size <= 1) {
+        return;
+    }
+    proof_begin(proof, true);
+    for (int i = 0; i < size; i++) {
+        proof_literal(proof, literals[i]);
+    }
+    proof_end(proof);
+}
@@ -0,0 +1,588 @@
+#include "sat.h"
+
+// A simple forward DRAT checker (--check-proof), independent of the search
+// code: its own clause store, two watched literals and propagation. The
+// lemmas of the proof are checked in order against the formula and the
+// lemmas before them: a lemma must be implied by unit propagation (RUP),
+// or else be a resolution asymmetric tautology on its first literal (RAT).
+// The proof is valid if the clauses become inconsistent at the root,
+// normally by the addition of the empty clause.
+//
+// Units propagated at the root are kept when the clauses that implied them
+// are deleted, and deletions of unit clauses are ignored, as DRAT-trim does.
+// Every lemma is checked, not just those the refutation needs, so this is
+// slower than a backward checker on long proofs.
+
+typedef struct {
+    int start; //offset of the literals in the pool
+    int size;
+    bool deleted;
+    uint64_t hash; //of the set of literals, for finding deletions
+    int next; //next clause in the same hash bucket, -1 at the end
+} CheckedClause;
+
+typedef struct {
+    int* clauses;
+    int size;
+    int capacity;
+} CheckWatches;
+
+typedef struct {
+    int num_variables;
+    Lit* pool;
+    long long pool_size;
+    long long pool_capacity;
+    CheckedClause* clauses;
+    int num_clauses;
+    int capacity;
+    CheckWatches* watches; //clauses watching each literal, may list deleted ones
+    signed char* value; //per literal: 1 true, -1 false, 0 unassigned
+    Lit* trail;
+    int trail_size;
+    int head; //trail entries before this one are propagated
+    int* buckets;
+    int num_buckets; //a power of two
+    int* marks; //per literal, stamp of the clause being compared
+    int stamp;
+    Lit* scratch; //resolvents of RAT checks, at most one copy of each literal
+    bool inconsistent; //the root assignment falsifies a clause
+    long long rat_lemmas;
+    long long ignored_deletions;
+} Checker;
+
+static void* grow(void* array, int* capacity, int needed, size_t element) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    array = realloc(array, new_capacity * element);
+    if (!array) {
+        perror("Failed to reallocate memory for proof checking");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return array;
+}
+
+// Proof steps, read before checking so the number of variables is known
+typedef struct {
+    Lit* literals;
+    long long size;
+    long long capacity;
+    long long* ends; //literals of step i end at ends[i], negated for deletions
+    int num_steps;
+    int steps_capacity;
+    int max_variable;
+} ProofSteps;
+
+static void push_proof_literal(ProofSteps* steps, Lit lit) {
+    if (steps->size == steps->capacity) {
+        steps->capacity = steps->capacity ? 2 * steps->capacity : 1 << 16;
+        steps->literals = (Lit*)realloc(steps->literals, steps->capacity * sizeof(Lit));
+        if (!steps->literals) {
+            perror("Failed to reallocate memory for proof checking");
+            exit(EXIT_FAILURE);
+        }
+    }
+    steps->literals[steps->size++] = lit;
+    if (lit_var(lit) + 1 > steps->max_variable) {
+        steps->max_variable = lit_var(lit) + 1;
+    }
+}
+
+static void end_proof_step(ProofSteps* steps, bool deletion) {
+    steps->ends = (long long*)grow(steps->ends, &steps->steps_capacity, steps->num_steps + 1, sizeof(long long));
+    steps->ends[steps->num_steps++] = deletion ? -steps->size - 1 : steps->size;
+}
+
+// A binary proof starts with 'a' or 'd' and ends every clause with a 0
+// byte, while a text proof holds only printable characters and whitespace.
+// Literal codes may look like text, so a prefix is scanned.
+static bool binary_proof(const unsigned char* data, size_t size) {
+    if (size > 0 && data[0] == 'a') {
+        return true;
+    }
+    for (size_t i = 0; i < size && i < 1024; i++) {
+        if ((data[i] < 32 && data[i] != '\n' && data[i] != '\r' && data[i] != '\t') || data[i] > 126) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_binary_proof(const unsigned char* data, size_t size, ProofSteps* steps) {
+    size_t i = 0;
+    while (i < size) {
+        unsigned char kind = data[i++];
+        if (kind != 'a' && kind != 'd') {
+            fprintf(stderr, "Invalid binary proof: unexpected byte %d at offset %zu\n", kind, i - 1);
+            return false;
+        }
+        while (true) {
+            uint64_t code = 0;
+            int shift = 0;
+            do {
+                if (i >= size || shift > 28) {
+                    fprintf(stderr, "Invalid binary proof: truncated literal at offset %zu\n", i);
+                    return false;
+                }
+                code |= (uint64_t)(data[i] & 127) << shift;
+                shift += 7;
+            } while (data[i++] & 128);
+            if (code == 0) {
+                break;
+            }
+            if (code < 2) {
+                fprintf(stderr, "Invalid binary proof: literal code %llu\n", (unsigned long long)code);
+                return false;
+            }
+            push_proof_literal(steps, (Lit)(code - 2));
+        }
+        end_proof_step(steps, kind == 'd');
+    }
+    return true;
+}
+
+static bool read_text_proof(const unsigned char* data, size_t size, ProofSteps* steps) {
+    size_t i = 0;
+    bool deletion = false, in_step = false;
+    while (i < size) {
+        unsigned char c = data[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            i++;
+        } else if (c == 'c' && !in_step) {
+            while (i < size && data[i] != '\n') {
+                i++;
+            }
+        } else if (c == 'd' && !in_step) {
+            deletion = true;
+            in_step = true;
+            i++;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            bool negative = c == '-';
+            i += negative;
+            long long var = 0;
+            if (i >= size || data[i] < '0' || data[i] > '9') {
+                fprintf(stderr, "Invalid text proof: bad literal at offset %zu\n", i);
+                return false;
+            }
+            while (i < size && data[i] >= '0' && data[i] <= '9') {
+                var = var * 10 + (data[i++] - '0');
+                if (var > INT32_MAX / 2) {
+                    fprintf(stderr, "Invalid text proof: variable too large at offset %zu\n", i);
+                    return false;
+                }
+            }
+            if (var == 0) {
+                end_proof_step(steps, deletion);
+                deletion = false;
+                in_step = false;
+            } else {
+                push_proof_literal(steps, make_lit((int)var - 1, negative));
+                in_step = true;
+            }
+        } else {
+            fprintf(stderr, "Invalid text proof: unexpected character '%c' at offset %zu\n", c, i);
+            return false;
+        }
+    }
+    if (in_step) {
+        fprintf(stderr, "Invalid text proof: the last clause is not terminated\n");
+        return false;
+    }
+    return true;
+}
+
+static bool read_proof(const char* filename, ProofSteps* steps) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open the proof file");
+        return false;
+    }
+    size_t size = 0, capacity = 1 << 20;
+    unsigned char* data = (unsigned char*)allocate_memory(capacity, "proof checking");
+    size_t length;
+    while ((length = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += length;
+        if (size == capacity) {
+            capacity *= 2;
+            data = (unsigned char*)realloc(data, capacity);
+            if (!data) {
+                perror("Failed to reallocate memory for proof checking");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    fclose(file);
+    bool valid = binary_proof(data, size) ? read_binary_proof(data, size, steps)
+                                          : read_text_proof(data, size, steps);
+    free(data);
+    return valid;
+}
+
+static uint64_t literal_hash(Lit lit) {
+    uint64_t z = lit + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Independent of the order of the literals
+static uint64_t clause_hash(const Lit* literals, int size) {
+    uint64_t hash = 0;
+    for (int i = 0; i < size; i++) {
+        hash += literal_hash(literals[i]);
+    }
+    return hash;
+}
+
+static Lit* checked_literals(Checker* checker, int c) {
+    return checker->pool + checker->clauses[c].start;
+}
+
+static void assign(Checker* checker, Lit lit) {
+    checker->value[lit] = 1;
+    checker->value[lit_negate(lit)] = -1;
+    checker->trail[checker->trail_size++] = lit;
+}
+
+static void undo(Checker* checker, int trail_size) {
+    while (checker->trail_size > trail_size) {
+        Lit lit = checker->trail[--checker->trail_size];
+        checker->value[lit] = 0;
+        checker->value[lit_negate(lit)] = 0;
+    }
+    checker->head = trail_size;
+}
+
+static void watch(Checker* checker, Lit lit, int c) {
+    CheckWatches* list = &checker->watches[lit];
+    list->clauses = (int*)grow(list->clauses, &list->capacity, list->size + 1, sizeof(int));
+    list->clauses[list->size++] = c;
+}
+
+// Propagate the trail from head. Returns false on a conflict.
+static bool propagate(Checker* checker) {
+    while (checker->head < checker->trail_size) {
+        Lit falsified = lit_negate(checker->trail[checker->head++]);
+        CheckWatches* list = &checker->watches[falsified];
+        int j = 0;
+        for (int i = 0; i < list->size; i++) {
+            int c = list->clauses[i];
+            if (checker->clauses[c].deleted) {
+                continue;
+            }
+            Lit* literals = checked_literals(checker, c);
+            if (literals[0] == falsified) {
+                literals[0] = literals[1];
+                literals[1] = falsified;
+            }
+            if (checker->value[literals[0]] == 1) {
+                list->clauses[j++] = c;
+                continue;
+            }
+            int size = checker->clauses[c].size;
+            int k = 2;
+            while (k < size && checker->value[literals[k]] == -1) {
+                k++;
+            }
+            if (k < size) {
+                literals[1] = literals[k];
+                literals[k] = falsified;
+                watch(checker, literals[1], c);
+                continue;
+            }
+            list->clauses[j++] = c;
+            if (checker->value[literals[0]] == -1) {
+                while (++i < list->size) {
+                    list->clauses[j++] = list->clauses[i];
+                }
+                list->size = j;
+                return false;
+            }
+            assign(checker, literals[0]);
+        }
+        list->size = j;
+    }
+    return true;
+}
+
+// Store a clause, without repeated literals, and bring the root assignment up to date
+static void add_checked_clause(Checker* checker, const Lit* literals, int size) {
+    checker->stamp++;
+    int kept = 0;
+    if (checker->pool_size + size > checker->pool_capacity) {
+        while (checker->pool_size + size > checker->pool_capacity) {
+            checker->pool_capacity = checker->pool_capacity ? 2 * checker->pool_capacity : 1 << 16;
+        }
+        checker->pool = (Lit*)realloc(checker->pool, checker->pool_capacity * sizeof(Lit));
+        if (!checker->pool) {
+            perror("Failed to reallocate memory for proof checking");
+            exit(EXIT_FAILURE);
+        }
+    }
+    Lit* stored = checker->pool + checker->pool_size;
+    for (int i = 0; i < size; i++) {
+        if (checker->marks[literals[i]] != checker->stamp) {
+            checker->marks[literals[i]] = checker->stamp;
+            stored[kept++] = literals[i];
+        }
+    }
+    checker->clauses = (CheckedClause*)grow(checker->clauses, &checker->capacity, checker->num_clauses + 1,
+                                            sizeof(CheckedClause));
+    int c = checker->num_clauses++;
+    CheckedClause* clause = &checker->clauses[c];
+    clause->start = (int)checker->pool_size;
+    clause->size = kept;
+    clause->deleted = false;
+    clause->hash = clause_hash(stored, kept);
+    int bucket = (int)(clause->hash & (checker->num_buckets - 1));
+    clause->next = checker->buckets[bucket];
+    checker->buckets[bucket] = c;
+    checker->pool_size += kept;
+
+    if (checker->inconsistent) {
+        return;
+    }
+    // watch two literals that are not false, if there are
+    for (int w = 0; w < 2 && w < kept; w++) {
+        for (int i = w; i < kept; i++) {
+            if (checker->value[stored[i]] != -1) {
+                Lit lit = stored[w];
+                stored[w] = stored[i];
+                stored[i] = lit;
+                break;
+            }
+        }
+    }
+    if (kept == 0 || checker->value[stored[0]] == -1) {
+        checker->inconsistent = true;
+        return;
+    }
+    if (kept >= 2) {
+        watch(checker, stored[0], c);
+        watch(checker, stored[1], c);
+    }
+    if ((kept == 1 || checker->value[stored[1]] == -1) && checker->value[stored[0]] == 0) {
+        assign(checker, stored[0]);
+        if (!propagate(checker)) {
+            checker->inconsistent = true;
+        }
+    }
+}
+
+// One bucket per expected clause at least
+static void init_buckets(Checker* checker, int clauses) {
+    checker->num_buckets = 1024;
+    while (checker->num_buckets < clauses) {
+        checker->num_buckets *= 2;
+    }
+    checker->buckets = (int*)allocate_memory(checker->num_buckets * sizeof(int), "proof checking");
+    memset(checker->buckets, -1, checker->num_buckets * sizeof(int));
+}
+
+// Mark the stored copy of the clause deleted, if there is one
+static void delete_checked_clause(Checker* checker, const Lit* literals, int size) {
+    checker->stamp++;
+    int distinct = 0;
+    for (int i = 0; i < size; i++) {
+        if (checker->marks[literals[i]] != checker->stamp) {
+            checker->marks[literals[i]] = checker->stamp;
+            distinct++;
+        }
+    }
+    if (distinct <= 1) {
+        checker->ignored_deletions++;
+        return;
+    }
+    uint64_t hash = 0;
+    for (int i = 0; i < size; i++) {
+        bool repeated = false;
+        for (int j = 0; j < i && !repeated; j++) {
+            repeated = literals[j] == literals[i];
+        }
+        hash += repeated ? 0 : literal_hash(literals[i]);
+    }
+    int* link = &checker->buckets[hash & (checker->num_buckets - 1)];
+    while (*link >= 0) {
+        CheckedClause* clause = &checker->clauses[*link];
+        bool same = clause->hash == hash && clause->size == distinct;
+        Lit* stored = checked_literals(checker, *link);
+        for (int i = 0; i < clause->size && same; i++) {
+            same = checker->marks[stored[i]] == checker->stamp;
+        }
+        if (same) {
+            clause->deleted = true;
+            *link = clause->next;
+            return;
+        }
+        link = &clause->next;
+    }
+    checker->ignored_deletions++;
+}
+
+// Does propagating the negation of the clause conflict?
+static bool implied_by_propagation(Checker* checker, const Lit* literals, int size) {
+    if (checker->inconsistent) {
+        return true;
+    }
+    int trail_size = checker->trail_size;
+    bool conflict = false;
+    for (int i = 0; i < size && !conflict; i++) {
+        if (checker->value[literals[i]] == 1) {
+            conflict = true;
+        } else if (checker->value[literals[i]] == 0) {
+            assign(checker, lit_negate(literals[i]));
+        }
+    }
+    conflict = conflict || !propagate(checker);
+    undo(checker, trail_size);
+    return conflict;
+}
+
+// Is the lemma a RAT on its first literal: are its resolvents with every
+// clause containing the complement implied by propagation?
+static bool resolution_asymmetric_tautology(Checker* checker, const Lit* literals, int size) {
+    if (size == 0) {
+        return false;
+    }
+    Lit pivot = literals[0];
+    for (int c = 0; c < checker->num_clauses; c++) {
+        CheckedClause* clause = &checker->clauses[c];
+        Lit* other = checked_literals(checker, c);
+        bool contains = false;
+        for (int i = 0; i < clause->size && !contains; i++) {
+            contains = other[i] == lit_negate(pivot);
+        }
+        if (clause->deleted || !contains) {
+            continue;
+        }
+        int resolvent_size = 0;
+        bool tautology = false;
+        checker->stamp++;
+        for (int i = 0; i < size; i++) {
+            checker->marks[literals[i]] = checker->stamp;
+            checker->scratch[resolvent_size++] = literals[i];
+        }
+        for (int i = 0; i < clause->size && !tautology; i++) {
+            if (other[i] == lit_negate(pivot) || checker->marks[other[i]] == checker->stamp) {
+                continue;
+            }
+            tautology = checker->marks[lit_negate(other[i])] == checker->stamp;
+            checker->scratch[resolvent_size++] = other[i];
+        }
+        if (!tautology && !implied_by_propagation(checker, checker->scratch, resolvent_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Checker* create_checker(int num_variables, int clauses) {
+    Checker* checker = (Checker*)calloc(1, sizeof(Checker));
+    if (!checker) {
+        perror("Failed to allocate memory for proof checking");
+        exit(EXIT_FAILURE);
+    }
+    int n = num_variables;
+    checker->num_variables = n;
+    checker->watches = (CheckWatches*)calloc(2 * n + 2, sizeof(CheckWatches));
+    checker->value = (signed char*)calloc(2 * n + 2, 1);
+    checker->marks = (int*)calloc(2 * n + 2, sizeof(int));
+    checker->trail = (Lit*)allocate_memory((n + 1) * sizeof(Lit), "proof checking");
+    checker->scratch = (Lit*)allocate_memory((2 * n + 2) * sizeof(Lit), "proof checking");
+    if (!checker->watches || !checker->value || !checker->marks) {
+        perror("Failed to allocate memory for proof checking");
+        exit(EXIT_FAILURE);
+    }
+    init_buckets(checker, clauses);
+    return checker;
+}
+
+static void free_checker(Checker* checker) {
+    for (int i = 0; i < 2 * checker->num_variables; i++) {
+        free(checker->watches[i].clauses);
+    }
+    free(checker->watches);
+    free(checker->value);
+    free(checker->marks);
+    free(checker->trail);
+    free(checker->scratch);
+    free(checker->buckets);
+    free(checker->pool);
+    free(checker->clauses);
+    free(checker);
+}
+
+// Check the DRAT proof in filename (binary or text) against formula, printing
+// the verdict as an "s VERIFIED" or "s NOT VERIFIED" line.
+bool check_proof(Formula* formula, const char* filename) {
+    double start = stats_clock();
+    ProofSteps steps = {NULL, 0, 0, NULL, 0, 0, 0};
+    if (!read_proof(filename, &steps)) {
+        free(steps.literals);
+        free(steps.ends);
+        printf("s NOT VERIFIED\n");
+        return false;
+    }
+    int n = formula->num_variables > steps.max_variable ? formula->num_variables : steps.max_variable;
+    Checker* checker = create_checker(n, formula->size + steps.num_steps);
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        add_checked_clause(checker, clause->literals, clause->size);
+    }
+
+    bool valid = true;
+    long long lemmas = 0, deletions = 0, begin = 0;
+    for (int i = 0; i < steps.num_steps && valid && !checker->inconsistent; i++) {
+        bool deletion = steps.ends[i] < 0;
+        long long end = deletion ? -steps.ends[i] - 1 : steps.ends[i];
+        Lit* literals = steps.literals + begin;
+        int size = (int)(end - begin);
+        begin = end;
+        if (deletion) {
+            delete_checked_clause(checker, literals, size);
+            deletions++;
+            continue;
+        }
+        lemmas++;
+        // repeated literals are dropped, so a resolvent never holds more
+        // than one copy of each literal and fits in scratch
+        checker->stamp++;
+        int distinct = 0;
+        for (int j = 0; j < size; j++) {
+            if (checker->marks[literals[j]] != checker->stamp) {
+                checker->marks[literals[j]] = checker->stamp;
+                literals[distinct++] = literals[j];
+            }
+        }
+        size = distinct;
+        if (!implied_by_propagation(checker, literals, size)) {
+            if (!resolution_asymmetric_tautology(checker, literals, size)) {
+                printf("c lemma %lld (proof line %d) is neither RUP nor RAT:", lemmas, i + 1);
+                for (int j = 0; j < size; j++) {
+                    printf(" %d", lit_to_dimacs(literals[j]));
+                }
+                printf(" 0\n");
+                valid = false;
+                break;
+            }
+            checker->rat_lemmas++;
+        }
+        add_checked_clause(checker, literals, size);
+    }
+    bool verified = valid && checker->inconsistent;
+    if (valid && !verified) {
+        printf("c the proof does not derive the empty clause\n");
+    }
+    printf("c checked %lld lemmas (%lld RAT) and %lld deletions (%lld ignored) in %.3f seconds\n",
+           lemmas, checker->rat_lemmas, deletions, checker->ignored_deletions, stats_clock() - start);
+    printf("s %s\n", verified ? "VERIFIED" : "NOT VERIFIED");
+    free_checker(checker);
+    free(steps.literals);
+    free(steps.ends);
+    return verified;
+}
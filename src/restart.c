@@ -0,0 +1,63 @@
+#include "sat.h"
+
+// Restart scheduling. Both policies are driven from the conflict loop in
+// solve_dpll through restart_due(), which is called once per conflict with
+// the LBD of the clause just learned.
+
+// Luby sequence 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ... (x is 0-based)
+int luby(int x) {
+    int size, seq;
+    for (size = 1, seq = 0; size < x + 1; seq++, size = 2 * size + 1);
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        seq--;
+        x = x % size;
+    }
+    return 1 << seq;
+}
+
+void init_restarts(RestartState* restart, SolverOptions* options) {
+    restart->conflicts_since_restart = 0;
+    restart->luby_index = 0;
+    restart->luby_limit = options->restart_unit * luby(0);
+    restart->lbd_fast = 0;
+    restart->lbd_slow = 0;
+    restart->lbd_conflicts = 0;
+    restart->restarts = 0;
+}
+
+// Exponential moving average with bias correction for the first samples
+static double update_average(double average, double value, double alpha, long long samples) {
+    double rate = 1.0 / samples;
+    if (rate < alpha) {
+        rate = alpha;
+    }
+    return average + rate * (value - average);
+}
+
+// Record a conflict and tell whether the search should restart now
+bool restart_due(RestartState* restart, SolverOptions* options, int lbd) {
+    restart->conflicts_since_restart++;
+    restart->lbd_conflicts++;
+    restart->lbd_fast = update_average(restart->lbd_fast, lbd, RESTART_FAST_ALPHA, restart->lbd_conflicts);
+    restart->lbd_slow = update_average(restart->lbd_slow, lbd, RESTART_SLOW_ALPHA, restart->lbd_conflicts);
+
+    switch (options->restart_policy) {
+        case RESTART_LUBY:
+            return restart->conflicts_since_restart >= restart->luby_limit;
+        case RESTART_GLUCOSE:
+            // recent clauses are much worse than the long term average: the
+            // current part of the search space is not going anywhere
+            return restart->conflicts_since_restart >= RESTART_GLUCOSE_MIN_CONFLICTS
+                && restart->lbd_fast > RESTART_GLUCOSE_MARGIN * restart->lbd_slow;
+    }
+    return false;
+}
+
+// Account for a restart and schedule the next one
+void restart_done(RestartState* restart, SolverOptions* options) {
+    restart->restarts++;
+    restart->conflicts_since_restart = 0;
+    restart->luby_index++;
+    restart->luby_limit = options->restart_unit * luby(restart->luby_index);
+}
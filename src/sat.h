@@ -5,14 +5,109 @@
 #define UIP_UNRESOLVED 0
 #define UIP_CONFLICT 1
 
-#define ANTECEDENT_CLAUSE_NONE -1
+#define CLAUSE_REF_NONE UINT32_MAX
+#define ANTECEDENT_CLAUSE_NONE CLAUSE_REF_NONE
 
 #define CLAUSE_UNSAT 0
 #define CLAUSE_SAT 1
 #define CLAUSE_UNIT 2
 #define CLAUSE_UNRESOLVED 3
 
+#define LITERAL_FALSE 0
+#define LITERAL_TRUE 1
+#define LITERAL_UNASSIGNED 2
+
+#define HEURISTIC_STATIC 0
+#define HEURISTIC_VSIDS 1
+
+#define POLARITY_FALSE 0
+#define POLARITY_TRUE 1
+#define POLARITY_SAVED 2
+#define POLARITY_RANDOM 3
+#define POLARITY_TARGET 4
+#define POLARITY_BEST 5
+
+#define PHASE_UNSET -1
+
+#define RESTART_NONE 0
+#define RESTART_LUBY 1
+#define RESTART_GLUCOSE 2
+
+#define RESTART_FAST_ALPHA (1.0 / 32)
+#define RESTART_SLOW_ALPHA (1.0 / 8192)
+#define RESTART_GLUCOSE_MIN_CONFLICTS 50
+#define RESTART_GLUCOSE_MARGIN 1.25
+
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_XZ 2
+#define COMPRESSION_BZIP2 3
+
+// Clause sharing between portfolio threads
+#define SHARE_RING_SIZE 4096 //clauses each thread keeps available to the others
+#define SHARE_MAX_LITERALS 32 //no longer clause can be shared
+#define SHARE_MAX_SIZE 8 //default size filter
+#define SHARE_MAX_LBD 2 //default LBD filter, units and binaries are always shared
+
+// Cube and conquer
+#define CUBE_MAX_DEPTH 20 //at most 2^depth cubes
+#define LOOKAHEAD_CANDIDATES 32 //variables probed at each node of the split
+
+// Preprocessing
+#define SUBSUME_MAX_OCCURRENCES 1000 //clauses checked against one clause for subsumption
+#define ELIM_MAX_OCCURRENCES 32 //variables in more clauses are not eliminated (unless pure)
+#define ELIM_RESOLVENT_SIZE 20 //longest resolvent variable elimination may add
+#define ELIM_GROWTH 0 //resolvents allowed beyond the number of clauses removed
+
+// Failed-literal probing
+#define PROBE_INITIAL_EFFORT 2000000 //propagations spent probing before the search
+#define PROBE_INTERVAL 5000 //conflicts between probing rounds during the search
+#define PROBE_EFFORT 0.1 //a round may spend this share of the search propagations since the last one
+
+// Local search (probSAT)
+#define SLS_NONE 0
+#define SLS_ONLY 1 //local search instead of CDCL
+#define SLS_HYBRID 2 //local search rounds at restarts set the saved phases
+#define SLS_CB 2.06 //a variable is picked with weight (SLS_EPS + break)^-SLS_CB, tuned for 3-SAT
+#define SLS_EPS 0.9
+#define SLS_MAX_BREAK 32 //higher break counts get the weight of this one
+#define SLS_INITIAL_FLIPS 10 //hybrid: flips per clause before the first decision
+#define SLS_INTERVAL 2000 //hybrid: conflicts between rounds during the search
+#define SLS_EFFORT 0.2 //hybrid: a round may flip this many times per search propagation since the last one
+#define SLS_STANDALONE_FLIPS 2000000000LL //--sls=only gives up after this many flips
+
+// Statistics, see stats.c. Counters that only feed the statistics are
+// updated through STAT_ADD, which compiles to nothing with -DSAT_NO_STATS
+// (make STATS=0).
+#define STATS_NONE 0
+#define STATS_TEXT 1 //a block of "c" lines
+#define STATS_JSON 2 //one JSON object
+#ifdef SAT_NO_STATS
+#define STAT_ADD(counter, amount) ((void)0)
+#else
+#define STAT_ADD(counter, amount) ((counter) += (amount))
+#endif
+
+// Microbenchmarks, see bench.c
+#define BENCH_SEED 20240601ULL //every generated input and random decision derives from it
+#define BENCH_REPEATS 11 //timed runs of each benchmark
+#define BENCH_WARMUP 1 //untimed runs before them
+#define BENCH_TOLERANCE 0.05 //a median this much worse than the baseline, and outside its p10-p90 range, is a regression
+
+// Proofs (--proof)
+#define PROOF_BUFFER (1 << 22) //bytes of proof collected before a write
+
+// Learned clause database
+#define REDUCE_FIRST 2000 //conflicts before the first reduction
+#define REDUCE_INCREMENT 300 //the interval between reductions grows by this much
+#define CORE_LBD 2 //glue clauses, never deleted
+#define TIER2_LBD 6 //kept as long as they keep being used
+#define CLAUSE_ACTIVITY_DECAY 0.999
+#define ARENA_GC_FRACTION 0.2 //collect the arena when this share of it belongs to deleted clauses
+
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,79 +116,528 @@
 // negative integers for complemented literals. 0 is not a valid literal.
 typedef int Literal;
 
-// A clause is a sum of literals
+// Solver-internal literal representation: 2*var+sign with 0-based variables
+// and sign 1 for complemented literals, so literals index arrays directly
+// and the complement of lit is lit^1.
+typedef uint32_t Lit;
+
+static inline Lit make_lit(int var, bool negated) {
+    return (Lit)(2 * var + negated);
+}
+
+static inline int lit_var(Lit lit) {
+    return (int)(lit >> 1);
+}
+
+static inline bool lit_negated(Lit lit) {
+    return lit & 1;
+}
+
+static inline Lit lit_negate(Lit lit) {
+    return lit ^ 1;
+}
+
+static inline Lit dimacs_to_lit(Literal lit) {
+    return lit > 0 ? make_lit(lit - 1, false) : make_lit(-lit - 1, true);
+}
+
+static inline Literal lit_to_dimacs(Lit lit) {
+    return lit_negated(lit) ? -(lit_var(lit) + 1) : lit_var(lit) + 1;
+}
+
+// A clause is a sum of literals. Used to build clauses before they are added
+// to a formula, which stores them in its arena.
 typedef struct {
     Literal* literals;
     int size;
     int capacity;
-} Clause;                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                
+} Clause;
+
+// Reference to a clause: its offset in 32-bit words in the clause arena
+typedef uint32_t ClauseRef;
+
+// A clause in the arena: a three word header immediately followed by its literals
+typedef struct {
+    uint32_t size;
+    uint32_t learned : 1;
+    uint32_t used : 1; //learned: used in conflict analysis since the last reduction
+    uint32_t deleted : 1;
+    uint32_t relocated : 1; //moved by the garbage collector, see relocation
+    uint32_t imported : 1; //learned by another thread and not used here yet
+    uint32_t lbd : 27; //learned: number of distinct decision levels (lowered when used)
+    union {
+        float activity; //learned: bumped when used in conflict analysis
+        ClauseRef relocation; //new reference once relocated
+    };
+    Lit literals[];
+} StoredClause;
+
+#define CLAUSE_HEADER_WORDS (sizeof(StoredClause) / sizeof(uint32_t))
+
+// Contiguous storage for all clauses of a formula
+typedef struct {
+    uint32_t* memory;
+    uint32_t size; //words in use
+    uint32_t capacity;
+    uint32_t wasted; //words taken by deleted clauses
+} ClauseArena;
+
+// A binary clause in the watch list of one of its literals: once that
+// literal is false the other is implied, without reading the clause
+typedef struct {
+    Lit implied;
+    ClauseRef clause; //reason for the implication
+} BinaryWatch;
+
+// A ternary clause in the watch list of one of its first two literals,
+// with the other two inline: while one of them is true the clause is
+// satisfied and propagation skips it without reading it
+typedef struct {
+    Lit other[2];
+    ClauseRef clause;
+} TernaryWatch;
+
+// Clauses watching a literal, by size. Binary clauses are watched by both
+// literals, longer ones by their first two literals.
+typedef struct {
+    BinaryWatch* binaries;
+    int num_binaries;
+    int binary_capacity;
+    TernaryWatch* ternaries;
+    int num_ternaries;
+    int ternary_capacity;
+    ClauseRef* clauses;
+    int size;
+    int capacity;
+} WatchList;
+
+// DRAT proof being written, see proof.c
+typedef struct {
+    FILE* file;
+    unsigned char* buffer; //PROOF_BUFFER bytes, written out when full
+    size_t size;
+    bool binary; //binary DRAT, or the text format
+    bool failed; //a write failed, the proof is incomplete
+    long long added;
+    long long deleted;
+} Proof;
 
 // A formula in CNF is a product of clauses
 typedef struct {
-    Clause* clauses;
+    ClauseArena arena; //every clause, original and learned
+    ClauseRef* clauses; //original clauses
     int size;
     int capacity;
+    ClauseRef* learned; //clauses added by conflict analysis, periodically reduced
+    int num_learned;
+    int learned_capacity;
     int num_variables;
+    WatchList* watches; // one list per literal, indexed by Lit. NULL until init_watches()
+    int watched_variables; // number of variables the watches array is sized for
+    Proof* proof; // every clause added or deleted is logged here, NULL if there is no proof
 } Formula;
 
 
+// Incremental DIMACS parser state, see parser.c
+typedef struct {
+    Formula* formula; //created when the problem line is read
+    Formula* recycled; //if set, cleared and used instead of a new formula
+    int state;
+    long line; //for error messages
+    char header[128]; //problem line being read
+    int header_size;
+    int num_variables; //as declared on the problem line
+    int num_clauses;
+    bool negative; //number being scanned
+    int digits;
+    long long value;
+    Lit* literals; //clause being read
+    int size;
+    int capacity;
+} DimacsParser;
+
+// Indexed binary max-heap of variables ordered by activity
+typedef struct {
+    int* heap; //variable indices, heap ordered
+    int* position; //position of each variable in heap, -1 if not in the heap
+    int size;
+    double* activity; //owned by the assignment
+} VariableHeap;
+
+// Search parameters, set from the command line
+typedef struct {
+    int decision_heuristic; //HEURISTIC_STATIC or HEURISTIC_VSIDS
+    double activity_decay; //EVSIDS: the bump grows by 1/decay after every conflict
+    int polarity; //POLARITY_*: value given to a decision variable
+    unsigned long long seed; //for the random polarity
+    int restart_policy; //RESTART_NONE, RESTART_LUBY or RESTART_GLUCOSE
+    int restart_unit; //conflicts per unit of the Luby sequence
+    int threads; //portfolio threads, 1 for a single sequential search
+    bool share; //portfolio threads exchange learned clauses
+    int share_max_size; //longest learned clause exported (units and binaries always are)
+    int share_max_lbd; //highest LBD exported
+    int cube_depth; //cube and conquer: split on up to this many variables, 0 to search directly
+    bool preprocess; //simplify the formula before the search, see preprocess.c
+    bool probe; //failed-literal probing before the search and at restarts, see probe.c
+    int sls; //SLS_NONE, SLS_ONLY or SLS_HYBRID, see sls.c
+    int stats; //STATS_NONE, STATS_TEXT or STATS_JSON: printed on stderr after solving
+    long long progress; //conflicts between progress lines on stderr, 0 for none
+} SolverOptions;
+
+// One slot of an export ring, guarded by its sequence number (see share.c)
+typedef struct {
+    atomic_ullong sequence;
+    atomic_int size;
+    atomic_int lbd;
+    _Atomic Lit literals[SHARE_MAX_LITERALS];
+} SharedSlot;
+
+// Clauses exported by one thread, written only by that thread
+typedef struct {
+    SharedSlot* slots; //SHARE_RING_SIZE slots
+    atomic_ullong head; //number of clauses ever written
+} ExportRing;
+
+typedef struct {
+    ExportRing* rings; //one per thread
+    int count;
+} ClauseExchange;
+
+// Restart scheduler state
+typedef struct {
+    int conflicts_since_restart;
+    int luby_index;
+    int luby_limit; //conflicts allowed before the next Luby restart
+    double lbd_fast; //moving averages of learned clause LBD
+    double lbd_slow;
+    long long lbd_conflicts; //samples in the averages
+    int restarts;
+} RestartState;
+
+// Where an assigned variable comes from. Conflict analysis reads both
+// fields together, so they share a cache line.
+typedef struct {
+    int level; //depth at which the variable was assigned
+    ClauseRef reason; //clause that implied the assignment, or ANTECEDENT_CLAUSE_NONE
+} VariableInfo;
 
 // Assignment of variables
 typedef struct {
-    bool* values; //default value is false
-    bool* assigned;
+    unsigned char* values; //per literal: LITERAL_TRUE, LITERAL_FALSE or LITERAL_UNASSIGNED
     int size;
+    int capacity; //number of variables the arrays are allocated for
     int current_depth_level; //global variable to process. Could also use a stack for depth, but maybe in the future
-    int* depth; //depth at which the literal was assigned
-    int* antecedent_clause; //clause that implied the assignment
+    VariableInfo* vars; //level and reason of each variable, valid while it is assigned
+    Lit* trail; //assigned literals in chronological order
+    int trail_size;
+    int* trail_lim; //trail_lim[d-1] is the trail size when depth d was opened
+    int propagation_head; //first trail literal whose watches have not been visited yet
+    int next_variable; //no variable below this index is unassigned
+    int units_checked; //original clauses already searched for units, see assign_unit_clauses
+    double* activity; //VSIDS score of each variable
+    double activity_increment;
+    VariableHeap order; //unassigned variables by activity (can also hold assigned ones lazily)
+    bool* saved_phase; //last value of each variable before it was unassigned
+    signed char* target_phase; //values on the longest conflict-free trail since the last restart, or PHASE_UNSET
+    int target_size;
+    signed char* best_phase; //values on the longest conflict-free trail ever, or PHASE_UNSET
+    int best_size;
+    unsigned long long random_state;
+    int* level_stamp; //scratch for compute_lbd, indexed by depth
+    int lbd_stamp;
+    bool* seen; //conflict analysis: variable is in the learned clause or known redundant
+    Lit* analyze_stack; //conflict analysis: literals left to check during minimization
+    Lit* analyze_clear; //conflict analysis: literals whose seen mark must be reset
+    int analyze_clear_size;
+    Lit* learned_buffer; //conflict analysis: reused for every learned clause
+    RestartState restart;
+    long long conflicts;
+    long long decisions;
+    long long propagations; //trail literals whose watches were visited
+    long long next_reduce; //conflict count of the next learned clause reduction
+    int reductions;
+    float clause_activity_increment;
+    SolverOptions options;
+    atomic_int* stop; //if set and non-zero, the search gives up
+    ClauseExchange* exchange; //clause sharing, NULL for a search on its own
+    int exchange_id; //this search's export ring
+    unsigned long long* import_cursor; //next position to import from each ring
+    long long shared_exported;
+    long long shared_imported; //imported clauses not satisfied at the root
+    long long shared_used; //imported clauses that took part in conflict analysis
+    long long shared_dropped; //overwritten before they could be imported
+    long long next_probe; //conflict count of the next probing round
+    long long probe_propagations; //propagation count at the end of the last probing round
+    int probe_cursor; //where the next round starts in the probing candidates
+    long long failed_literals; //found by probing
+    long long implied_literals; //implied by both values of a probed variable
+    long long next_sls; //conflict count of the next local search round
+    long long sls_propagations; //propagation count at the end of the last local search round
+    long long sls_flips;
+    int sls_rounds;
+    long long learned_clauses; //learned by conflict analysis (STAT_ADD)
+    long long learned_literals; //total size of those clauses (STAT_ADD)
+    long long learned_lbd; //total LBD of those clauses (STAT_ADD)
+    long long minimized_literals; //removed from them by minimization (STAT_ADD)
+    long long backjump_levels; //decision levels undone by backjumps after conflicts (STAT_ADD)
+    double search_start; //stats_clock() when the search started, for progress lines
+    bool interrupted; //the last search was stopped before it finished
+    const Lit* assumptions; //decided first, see solve_assuming
+    int num_assumptions;
+    bool assumption_failed; //the last search refuted the assumptions, not the formula
+    Lit* core; //assumptions that were refuted together, when assumption_failed
+    int core_size;
+
 } Assignment;
 
+// Value of a literal under the current assignment: a single load
+static inline int literal_value(const Assignment* assignment, Lit lit) {
+    return assignment->values[lit];
+}
+
+static inline bool variable_assigned(const Assignment* assignment, int var) {
+    return assignment->values[make_lit(var, false)] != LITERAL_UNASSIGNED;
+}
+
+// Incremental solver: a formula and its search state kept across calls,
+// see incremental.c
+typedef struct {
+    Formula* formula;
+    Assignment* assignment;
+    bool unsatisfiable; //the clauses alone have no model
+    Lit* buffer; //clause or assumptions being converted
+    int buffer_capacity;
+    Literal* core; //failed assumptions of the last call
+    int core_size;
+} SatSolver;
+
+// Clauses removed by variable elimination, each followed by its size and
+// with the eliminated literal first, to extend a model (see preprocess.c)
+typedef struct {
+    Lit* literals;
+    int size;
+    int capacity;
+} ReconstructionStack;
+
 // Function prototypes
 
+// Memory
+void* allocate_memory(size_t size, const char* what);
+
 // Formula operations
 Formula* create_formula();
 void free_formula(Formula* formula);
+void clear_formula(Formula* formula);
 void add_clause(Formula* formula, Clause* clause);
+ClauseRef add_original_clause(Formula* formula, const Lit* literals, int size);
 Clause* create_clause();
 void add_literal(Clause* clause, Literal lit);
 void free_clause(Clause* clause);
-int clause_status(Clause* clause, Assignment* assignment);
-int unit_propagation(Formula* formula, Assignment* assignment, Clause** conflict_clause);
+
+// Clause arena
+void init_arena(ClauseArena* arena);
+void free_arena(ClauseArena* arena);
+ClauseRef arena_alloc_clause(ClauseArena* arena, const Lit* literals, int size, bool learned);
+void delete_clause(Formula* formula, ClauseRef ref);
+
+static inline StoredClause* clause_at(Formula* formula, ClauseRef ref) {
+    return (StoredClause*)(formula->arena.memory + ref);
+}
+
+// Learned clause database
+ClauseRef add_learned_clause(Formula* formula, const Lit* literals, int size, int lbd);
+void bump_clause_activity(Assignment* assignment, Formula* formula, StoredClause* clause);
+bool clause_locked(Formula* formula, Assignment* assignment, ClauseRef ref);
+void reduce_learned_clauses(Formula* formula, Assignment* assignment);
+void collect_garbage(Formula* formula, Assignment* assignment);
+
+// Watch lists
+void init_watches(Formula* formula);
+void attach_clause(Formula* formula, ClauseRef ref);
+void rebuild_watches(Formula* formula);
+void detach_deleted_clauses(Formula* formula, const ClauseRef* refs, int count);
+void add_watch(WatchList* watch_list, ClauseRef ref);
+void add_ternary_watch(WatchList* watch_list, Lit first, Lit second, ClauseRef ref);
+void free_watches(Formula* formula);
+int clause_status(StoredClause* clause, Assignment* assignment);
+int unit_propagation(Formula* formula, Assignment* assignment, ClauseRef* conflict_clause);
 
 // Parser
 Formula* parse_cnf_file(const char* filename);
 Formula* parse_cnf_dimacs(FILE* file);
+Formula* parse_cnf_buffer(const char* data, size_t size);
+Formula* parse_cnf_file_into(const char* filename, Formula* recycled);
+void dimacs_init(DimacsParser* parser);
+bool dimacs_feed(DimacsParser* parser, const char* data, size_t size);
+Formula* dimacs_finish(DimacsParser* parser);
+
+// Input streams and archives
+typedef struct InputStream InputStream;
+typedef void (*TarMemberHandler)(const char* name, Formula* formula, void* context);
+int detect_compression(const unsigned char* magic, size_t size);
+InputStream* input_open(FILE* file);
+long input_read(InputStream* input, char* buffer, size_t size);
+void input_close(InputStream* input);
+int parse_cnf_tar(const char* filename, TarMemberHandler handler, void* context);
 
 // Solver
 bool solve(Formula* formula, Assignment* assignment);
 bool solve_dpll(Formula* formula, Assignment* assignment);
+bool solve_assuming(Formula* formula, Assignment* assignment, const Lit* assumptions, int size);
+bool assign_unit_clauses(Formula* formula, Assignment* assignment);
+bool search_stopped(Assignment* assignment);
 
 // Assignment operations
 Assignment* create_assignment(int num_variables);
+Assignment* recycle_assignment(Assignment* assignment, int num_variables);
+void grow_assignment(Assignment* assignment, int num_variables);
 void backtrack_assignment(Assignment* assignment, int backtrack_level);
+void new_decision_level(Assignment* assignment);
+void assign_literal(Assignment* assignment, Lit lit, ClauseRef antecedent);
 bool is_satisfied(Formula* formula, Assignment* assignment);
 bool all_variables_assigned(Assignment* assignment, Formula* formula);
 void print_assignment(Assignment* assignment);
 int choose_variable(Formula* formula, Assignment* assignment);
+void bump_variable_activity(Assignment* assignment, int var);
+void decay_variable_activity(Assignment* assignment);
+bool choose_polarity(Assignment* assignment, int var);
+unsigned long long next_random(Assignment* assignment);
+SolverOptions default_solver_options();
 void free_assignment(Assignment* assignment);
 
+// Variable heap
+void init_heap(VariableHeap* heap, int num_variables, double* activity);
+void clear_heap(VariableHeap* heap, int num_variables);
+void grow_heap(VariableHeap* heap, int old_size, int num_variables, double* activity);
+void free_heap(VariableHeap* heap);
+bool heap_contains(VariableHeap* heap, int var);
+void heap_insert(VariableHeap* heap, int var);
+void heap_increase(VariableHeap* heap, int var);
+int heap_pop_max(VariableHeap* heap);
+
 // Clause operations
 void print_clause(Clause* clause);
+int compute_lbd(const Lit* literals, int size, Assignment* assignment);
+
+// Restarts
+int luby(int x);
+void init_restarts(RestartState* restart, SolverOptions* options);
+bool restart_due(RestartState* restart, SolverOptions* options, int lbd);
+void restart_done(RestartState* restart, SolverOptions* options);
+
+// Statistics
+typedef struct {
+    double parse; //seconds
+    double preprocess;
+    double search;
+    double verify;
+} PhaseTimes;
+// Work of the phases around the search, filled for --stats when not NULL
+typedef struct {
+    bool preprocessed;
+    int clauses_before; //preprocessing
+    int clauses_removed;
+    int eliminated;
+    int fixed;
+    int subsumed;
+    int strengthened;
+    bool probed;
+    long long failed_literals; //probing before the search
+    long long implied_literals;
+    int substituted;
+    double probe_seconds;
+    int threads; //portfolio threads or cube workers, 0 for a single search
+    bool shared;
+    long long exported; //clause sharing, over all threads
+    long long imported;
+    long long used;
+    long long dropped;
+    int cubes; //cube and conquer
+    int refuted_branches;
+    int cubes_stolen;
+    double lookahead_seconds;
+} PhaseCounters;
+double stats_clock();
+void print_progress(Formula* formula, Assignment* assignment);
+void print_stats(FILE* out, int format, const char* result, bool verified, Formula* formula,
+                 Assignment* assignment, const PhaseTimes* times, const PhaseCounters* counters);
+
+// Portfolio
+Assignment* solve_portfolio(Formula* formula, SolverOptions* options, bool* result, PhaseCounters* counters);
+Formula* copy_formula(Formula* formula);
+
+// Incremental solving
+SatSolver* create_solver();
+SatSolver* create_solver_for(Formula* formula);
+void free_solver(SatSolver* solver);
+void solver_set_options(SatSolver* solver, const SolverOptions* options);
+bool solver_add_clause(SatSolver* solver, const Literal* literals, int size);
+bool solver_solve(SatSolver* solver, const Literal* assumptions, int size);
+int solver_value(SatSolver* solver, Literal lit);
+const Literal* solver_core(SatSolver* solver, int* size);
+
+// Preprocessing
+typedef struct Preprocessor Preprocessor;
+Formula* preprocess_formula(Formula* formula, ReconstructionStack* stack, bool probe, PhaseCounters* counters);
+Formula* preprocess_formula_into(Formula* formula, ReconstructionStack* stack, bool probe, PhaseCounters* counters,
+                                 Preprocessor** workspace, Formula* recycled);
+void free_preprocessor(Preprocessor* pp);
+void push_reconstruction_clause(ReconstructionStack* stack, Lit pivot, const Lit* literals, int size);
+void extend_model(ReconstructionStack* stack, Assignment* assignment);
+void free_reconstruction(ReconstructionStack* stack);
+
+// Probing and equivalent literals
+bool probe_failed_literals(Formula* formula, Assignment* assignment, long long budget);
+bool substitute_equivalences(Formula* formula, Assignment* assignment, ReconstructionStack* stack, int* substituted);
+bool probe_formula(Formula* formula, Assignment* assignment, ReconstructionStack* stack, int* substituted);
+void probe_search_formula(Formula* formula, ReconstructionStack* stack, PhaseCounters* counters);
+
+// Local search
+bool local_search_phases(Formula* formula, Assignment* assignment, long long flips);
+bool solve_local_search(Formula* formula, Assignment* assignment);
+
+// Cube and conquer
+Assignment* solve_cubes(Formula* formula, SolverOptions* options, bool* result, PhaseCounters* counters);
+
+// Clause sharing
+ClauseExchange* create_exchange(int threads);
+void free_exchange(ClauseExchange* exchange);
+void join_exchange(Assignment* assignment, ClauseExchange* exchange, int id);
+void export_clause(Assignment* assignment, const Lit* literals, int size, int lbd);
+bool import_clauses(Formula* formula, Assignment* assignment);
+
+// Batch mode
+int run_batch(const char* source, SolverOptions* options, FILE* csv);
 
 // Conflict analysis
-int conflict_analysis(Formula* formula, Clause* clause, Assignment* assignment);
-Clause* resolve_clauses(Clause* clause_a, Clause* clause_b, Literal literal);
+int conflict_analysis(Formula* formula, ClauseRef conflict, Assignment* assignment);
 // Test functions
 Formula* generate_random_formula(int num_vars, int num_clauses, int clause_size);
 bool test_random_formula(int num_vars, int num_clauses, int clause_size);
 bool run_performance_test();
 bool run_benchmark_test(const char* filename);
+bool run_incremental_test();
+bool run_local_search_test();
+bool run_parallel_test();
+bool run_reconstruction_test();
+bool run_proof_test();
+bool run_probe_test();
+bool run_parser_test();
+bool run_input_test();
 int run_all_tests();
 
+// Proofs
+Proof* open_proof(const char* filename, bool binary);
+bool close_proof(Proof* proof);
+void proof_begin(Proof* proof, bool deletion);
+void proof_literal(Proof* proof, Lit lit);
+void proof_end(Proof* proof);
+void proof_add(Proof* proof, const Lit* literals, int size);
+void proof_delete(Proof* proof, const Lit* literals, int size);
+bool check_proof(Formula* formula, const char* filename);
 
-//helper function to sort the depth levels. used for backtracking in analyze_conflict
-int comp(const void *a, const void *b);
-int getSecondLargest(int* array, int n);
+// Benchmarks
+int run_benchmarks(int repeats, const char* filter, const char* output, const char* baseline);
 
 
 #endif // SAT_H 
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "sat.h"
+
+// Learned clause exchange between portfolio threads. Every thread owns an
+// export ring that only it writes to; the other threads read it without any
+// lock and without ever making the writer wait. Each slot is guarded by a
+// sequence number (a seqlock): it is odd while the slot is being written and
+// 2*position+2 once the clause written at that position is complete. A
+// reader that lags more than SHARE_RING_SIZE clauses behind, or that sees a
+// slot being overwritten while it copies it, drops those clauses.
+// Threads export units, binaries and clauses passing the size/LBD filter
+// when they learn them, and import at level 0 (after a restart or a learned
+// unit), where imported clauses can be simplified by the root assignment.
+
+ClauseExchange* create_exchange(int threads) {
+    ClauseExchange* exchange = (ClauseExchange*)malloc(sizeof(ClauseExchange));
+    if (!exchange) {
+        perror("Failed to allocate memory for clause exchange");
+        exit(EXIT_FAILURE);
+    }
+    exchange->rings = (ExportRing*)malloc(threads * sizeof(ExportRing));
+    if (!exchange->rings) {
+        perror("Failed to allocate memory for export rings");
+        exit(EXIT_FAILURE);
+    }
+    exchange->count = threads;
+    for (int i = 0; i < threads; i++) {
+        ExportRing* ring = &exchange->rings[i];
+        ring->slots = (SharedSlot*)malloc(SHARE_RING_SIZE * sizeof(SharedSlot));
+        if (!ring->slots) {
+            perror("Failed to allocate memory for export ring");
+            exit(EXIT_FAILURE);
+        }
+        for (int j = 0; j < SHARE_RING_SIZE; j++) {
+            atomic_init(&ring->slots[j].sequence, 0);
+        }
+        atomic_init(&ring->head, 0);
+    }
+    return exchange;
+}
+
+void free_exchange(ClauseExchange* exchange) {
+    if (!exchange) return;
+    for (int i = 0; i < exchange->count; i++) {
+        free(exchange->rings[i].slots);
+    }
+    free(exchange->rings);
+    free(exchange);
+}
+
+// Connect the search of assignment to the exchange as thread id
+void join_exchange(Assignment* assignment, ClauseExchange* exchange, int id) {
+    assignment->exchange = exchange;
+    assignment->exchange_id = id;
+    assignment->import_cursor = (unsigned long long*)calloc(exchange->count, sizeof(unsigned long long));
+    if (!assignment->import_cursor) {
+        perror("Failed to allocate memory for import cursors");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Publish a freshly learned clause if it passes the filters
+void export_clause(Assignment* assignment, const Lit* literals, int size, int lbd) {
+    SolverOptions* options = &assignment->options;
+    if (size > 2 && (size > options->share_max_size || lbd > options->share_max_lbd)) {
+        return;
+    }
+    if (size > SHARE_MAX_LITERALS) {
+        return;
+    }
+    ExportRing* ring = &assignment->exchange->rings[assignment->exchange_id];
+    // only this thread writes head, a relaxed load sees its own last store
+    unsigned long long position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    SharedSlot* slot = &ring->slots[position % SHARE_RING_SIZE];
+
+    atomic_store_explicit(&slot->sequence, 2 * position + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->size, size, memory_order_relaxed);
+    atomic_store_explicit(&slot->lbd, lbd, memory_order_relaxed);
+    for (int i = 0; i < size; i++) {
+        atomic_store_explicit(&slot->literals[i], literals[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->sequence, 2 * position + 2, memory_order_release);
+    atomic_store_explicit(&ring->head, position + 1, memory_order_release);
+    assignment->shared_exported++;
+}
+
+// Copy the clause at position out of a ring; false if it was overwritten
+static bool read_slot(ExportRing* ring, unsigned long long position, Lit* literals, int* size, int* lbd) {
+    SharedSlot* slot = &ring->slots[position % SHARE_RING_SIZE];
+    unsigned long long sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != 2 * position + 2) {
+        return false;
+    }
+    *size = atomic_load_explicit(&slot->size, memory_order_relaxed);
+    *lbd = atomic_load_explicit(&slot->lbd, memory_order_relaxed);
+    if (*size > SHARE_MAX_LITERALS) {
+        return false;
+    }
+    for (int i = 0; i < *size; i++) {
+        literals[i] = atomic_load_explicit(&slot->literals[i], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
+
+// Add an imported clause at level 0: literals false at the root are dropped,
+// clauses satisfied at the root are ignored. Returns false on an empty clause.
+static bool import_clause(Formula* formula, Assignment* assignment, Lit* literals, int size, int lbd) {
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        int value = literal_value(assignment, literals[i]);
+        if (value == LITERAL_TRUE) {
+            return true;
+        }
+        if (value == LITERAL_UNASSIGNED) {
+            literals[kept++] = literals[i];
+        }
+    }
+    assignment->shared_imported++;
+    if (kept == 0) {
+        return false;
+    }
+    if (kept == 1) {
+        assign_literal(assignment, literals[0], ANTECEDENT_CLAUSE_NONE);
+        return true;
+    }
+    ClauseRef ref = add_learned_clause(formula, literals, kept, lbd < kept ? lbd : kept);
+    clause_at(formula, ref)->imported = true;
+    return true;
+}
+
+// Import everything the other threads exported since the last call. Must be
+// called at decision level 0; the caller propagates the imported units.
+// Returns false if an imported clause is falsified at the root (UNSAT).
+bool import_clauses(Formula* formula, Assignment* assignment) {
+    ClauseExchange* exchange = assignment->exchange;
+    Lit literals[SHARE_MAX_LITERALS];
+    for (int id = 0; id < exchange->count; id++) {
+        if (id == assignment->exchange_id) {
+            continue;
+        }
+        ExportRing* ring = &exchange->rings[id];
+        unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned long long position = assignment->import_cursor[id];
+        if (head - position > SHARE_RING_SIZE) {
+            assignment->shared_dropped += head - SHARE_RING_SIZE - position;
+            position = head - SHARE_RING_SIZE;
+        }
+        for (; position < head; position++) {
+            int size, lbd;
+            if (!read_slot(ring, position, literals, &size, &lbd)) {
+                assignment->shared_dropped++;
+                continue;
+            }
+            if (!import_clause(formula, assignment, literals, size, lbd)) {
+                assignment->import_cursor[id] = position + 1;
+                return false;
+            }
+        }
+        assignment->import_cursor[id] = position;
+    }
+    return true;
+}
@@ -0,0 +1,302 @@
+#include "sat.h"
+#include <math.h>
+
+// Stochastic local search (probSAT).
+//
+// A complete assignment is repaired one flip at a time: an unsatisfied
+// clause is picked at random and one of its variables is flipped, chosen
+// with probability proportional to (eps + break)^-cb, where the break count
+// of a variable is the number of clauses it alone satisfies. Every clause
+// keeps the number of its true literals and the XOR of their variables,
+// which is the only true variable while that number is 1, so a flip updates
+// the break counts and the list of unsatisfied clauses by visiting the
+// occurrences of the two literals of the flipped variable once.
+//
+// The search works on the original clauses simplified by the level 0
+// assignment: satisfied clauses are dropped, false literals removed and
+// assigned variables never flipped. It runs standalone (--sls=only), or
+// between restarts of solve_dpll (--sls=hybrid): there it starts from the
+// saved phases and the best assignment it reaches becomes the saved phases,
+// so the next descent follows it, and if that assignment is a model the
+// descent meets no conflict. probSAT's best setting for 3-SAT uses break
+// counts only, so no make counts are kept.
+
+typedef struct {
+    int num_variables;
+    int num_clauses;
+    int* start; //literals of clause c are literals[start[c] .. start[c + 1])
+    Lit* literals;
+    int* occurrence_start; //clauses containing lit are occurrences[occurrence_start[lit] .. occurrence_start[lit + 1])
+    int* occurrences;
+    int* true_count; //true literals of each clause
+    int* true_variables; //XOR of the variables of those literals
+    int* break_count; //clauses each variable alone satisfies
+    int* unsatisfied; //clauses with no true literal, in any order
+    int* position; //index of each clause in unsatisfied, -1 if it is satisfied
+    int num_unsatisfied;
+    bool* value;
+    bool* best; //assignment with the fewest unsatisfied clauses so far
+    int best_unsatisfied;
+    double break_weight[SLS_MAX_BREAK + 1]; //(eps + break)^-cb
+    double* weight; //scratch for the literals of the picked clause
+} LocalSearch;
+
+// Copy the original clauses not satisfied at level 0, without their false
+// or repeated literals, and index their occurrences
+static LocalSearch* create_local_search(Formula* formula, Assignment* assignment) {
+    LocalSearch* search = (LocalSearch*)allocate_memory(sizeof(LocalSearch), "local search");
+    int n = assignment->size;
+    search->num_variables = n;
+
+    int max_literals = 0, longest = 0;
+    for (int i = 0; i < formula->size; i++) {
+        int size = clause_at(formula, formula->clauses[i])->size;
+        max_literals += size;
+        longest = size > longest ? size : longest;
+    }
+    search->start = (int*)allocate_memory((formula->size + 1) * sizeof(int), "local search");
+    search->literals = (Lit*)allocate_memory(max_literals * sizeof(Lit), "local search");
+    search->occurrence_start = (int*)calloc(2 * n + 1, sizeof(int));
+    search->occurrences = (int*)allocate_memory(max_literals * sizeof(int), "local search");
+    search->true_count = (int*)allocate_memory(formula->size * sizeof(int), "local search");
+    search->true_variables = (int*)allocate_memory(formula->size * sizeof(int), "local search");
+    search->break_count = (int*)allocate_memory(n * sizeof(int), "local search");
+    search->unsatisfied = (int*)allocate_memory(formula->size * sizeof(int), "local search");
+    search->position = (int*)allocate_memory(formula->size * sizeof(int), "local search");
+    search->value = (bool*)allocate_memory(n * sizeof(bool), "local search");
+    search->best = (bool*)allocate_memory(n * sizeof(bool), "local search");
+    search->weight = (double*)allocate_memory(longest * sizeof(double), "local search");
+    int* mark = (int*)calloc(2 * n, sizeof(int)); //clause number + 1 of the last clause holding lit
+    if (!search->occurrence_start || !mark) {
+        perror("Failed to allocate memory for local search");
+        exit(EXIT_FAILURE);
+    }
+
+    int c = 0, k = 0;
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        if (clause->deleted) {
+            continue;
+        }
+        bool satisfied = false;
+        int first = k;
+        for (int j = 0; j < (int)clause->size && !satisfied; j++) {
+            Lit lit = clause->literals[j];
+            int value = literal_value(assignment, lit);
+            satisfied = value == LITERAL_TRUE || mark[lit_negate(lit)] == c + 1;
+            if (value == LITERAL_UNASSIGNED && mark[lit] != c + 1) {
+                mark[lit] = c + 1;
+                search->literals[k++] = lit;
+            }
+        }
+        if (satisfied) {
+            // a later clause gets the same number, so the marks are rewritten
+            for (int j = first; j < k; j++) {
+                mark[search->literals[j]] = 0;
+            }
+            k = first;
+            continue;
+        }
+        for (int j = first; j < k; j++) {
+            search->occurrence_start[search->literals[j] + 1]++;
+        }
+        search->start[c++] = first;
+    }
+    search->start[c] = k;
+    search->num_clauses = c;
+    free(mark);
+
+    for (int lit = 0; lit < 2 * n; lit++) {
+        search->occurrence_start[lit + 1] += search->occurrence_start[lit];
+    }
+    int* fill = (int*)allocate_memory(2 * n * sizeof(int), "local search");
+    memcpy(fill, search->occurrence_start, 2 * n * sizeof(int));
+    for (c = 0; c < search->num_clauses; c++) {
+        for (k = search->start[c]; k < search->start[c + 1]; k++) {
+            search->occurrences[fill[search->literals[k]]++] = c;
+        }
+    }
+    free(fill);
+
+    for (int b = 0; b <= SLS_MAX_BREAK; b++) {
+        search->break_weight[b] = pow(SLS_EPS + b, -SLS_CB);
+    }
+    return search;
+}
+
+static void free_local_search(LocalSearch* search) {
+    free(search->start);
+    free(search->literals);
+    free(search->occurrence_start);
+    free(search->occurrences);
+    free(search->true_count);
+    free(search->true_variables);
+    free(search->break_count);
+    free(search->unsatisfied);
+    free(search->position);
+    free(search->value);
+    free(search->best);
+    free(search->weight);
+    free(search);
+}
+
+static bool literal_true(LocalSearch* search, Lit lit) {
+    return search->value[lit_var(lit)] != lit_negated(lit);
+}
+
+static void make_unsatisfied(LocalSearch* search, int c) {
+    search->position[c] = search->num_unsatisfied;
+    search->unsatisfied[search->num_unsatisfied++] = c;
+}
+
+static void make_satisfied(LocalSearch* search, int c) {
+    int last = search->unsatisfied[--search->num_unsatisfied];
+    search->unsatisfied[search->position[c]] = last;
+    search->position[last] = search->position[c];
+    search->position[c] = -1;
+}
+
+// Counts and unsatisfied clauses from scratch, for the values in search->value
+static void initialize_counts(LocalSearch* search) {
+    memset(search->break_count, 0, search->num_variables * sizeof(int));
+    search->num_unsatisfied = 0;
+    for (int c = 0; c < search->num_clauses; c++) {
+        int count = 0, variables = 0;
+        for (int k = search->start[c]; k < search->start[c + 1]; k++) {
+            if (literal_true(search, search->literals[k])) {
+                count++;
+                variables ^= lit_var(search->literals[k]);
+            }
+        }
+        search->true_count[c] = count;
+        search->true_variables[c] = variables;
+        search->position[c] = -1;
+        if (count == 0) {
+            make_unsatisfied(search, c);
+        } else if (count == 1) {
+            search->break_count[variables]++;
+        }
+    }
+    memcpy(search->best, search->value, search->num_variables * sizeof(bool));
+    search->best_unsatisfied = search->num_unsatisfied;
+}
+
+static void flip(LocalSearch* search, int var) {
+    search->value[var] = !search->value[var];
+    Lit now_true = make_lit(var, !search->value[var]);
+    Lit now_false = lit_negate(now_true);
+
+    for (int i = search->occurrence_start[now_true]; i < search->occurrence_start[now_true + 1]; i++) {
+        int c = search->occurrences[i];
+        int count = ++search->true_count[c];
+        if (count == 1) {
+            make_satisfied(search, c);
+            search->break_count[var]++;
+        } else if (count == 2) {
+            // the variable that satisfied the clause alone no longer does
+            search->break_count[search->true_variables[c]]--;
+        }
+        search->true_variables[c] ^= var;
+    }
+    for (int i = search->occurrence_start[now_false]; i < search->occurrence_start[now_false + 1]; i++) {
+        int c = search->occurrences[i];
+        int count = --search->true_count[c];
+        search->true_variables[c] ^= var;
+        if (count == 0) {
+            make_unsatisfied(search, c);
+            search->break_count[var]--;
+        } else if (count == 1) {
+            search->break_count[search->true_variables[c]]++;
+        }
+    }
+}
+
+// probSAT: a variable of a random unsatisfied clause, the ones breaking fewer clauses more likely
+static int pick_variable(LocalSearch* search, Assignment* assignment) {
+    int c = search->unsatisfied[next_random(assignment) % search->num_unsatisfied];
+    int first = search->start[c], size = search->start[c + 1] - first;
+    double total = 0;
+    for (int k = 0; k < size; k++) {
+        int breaks = search->break_count[lit_var(search->literals[first + k])];
+        search->weight[k] = search->break_weight[breaks < SLS_MAX_BREAK ? breaks : SLS_MAX_BREAK];
+        total += search->weight[k];
+    }
+    double r = (next_random(assignment) >> 11) * 0x1.0p-53 * total;
+    int k = 0;
+    while (k < size - 1 && r >= search->weight[k]) {
+        r -= search->weight[k++];
+    }
+    return lit_var(search->literals[first + k]);
+}
+
+// Flip until every clause is satisfied or flips run out. Returns true on a model.
+static bool walk(LocalSearch* search, Assignment* assignment, long long flips) {
+    initialize_counts(search);
+    for (long long i = 0; i < flips && search->num_unsatisfied > 0; i++) {
+        if ((i & 1023) == 0 && search_stopped(assignment)) {
+            break;
+        }
+        flip(search, pick_variable(search, assignment));
+        assignment->sls_flips++;
+        if (search->num_unsatisfied < search->best_unsatisfied) {
+            search->best_unsatisfied = search->num_unsatisfied;
+            memcpy(search->best, search->value, search->num_variables * sizeof(bool));
+        }
+    }
+    return search->num_unsatisfied == 0;
+}
+
+// One hybrid round at level 0, after full propagation: walk for about flips
+// flips from the saved phases and save the best assignment reached as the
+// phases of the free variables. Returns true if it is a model.
+bool local_search_phases(Formula* formula, Assignment* assignment, long long flips) {
+    LocalSearch* search = create_local_search(formula, assignment);
+    memcpy(search->value, assignment->saved_phase, search->num_variables * sizeof(bool));
+    bool model = walk(search, assignment, flips);
+    for (int var = 0; var < search->num_variables; var++) {
+        if (!variable_assigned(assignment, var)) {
+            assignment->saved_phase[var] = search->best[var];
+        }
+    }
+    assignment->sls_rounds++;
+    free_local_search(search);
+    return model;
+}
+
+// Local search on its own, from a random assignment. Returns true with a
+// complete model in assignment. Returns false if level 0 propagation refutes
+// the formula, or with assignment->interrupted set when the search gives up
+// after SLS_STANDALONE_FLIPS flips or is stopped, as it cannot prove unsatisfiability.
+bool solve_local_search(Formula* formula, Assignment* assignment) {
+    ClauseRef conflict;
+    backtrack_assignment(assignment, 0);
+    assignment->interrupted = false;
+    if (assignment->options.seed) {
+        assignment->random_state = assignment->options.seed;
+    }
+    init_watches(formula);
+    if (!assign_unit_clauses(formula, assignment)
+        || unit_propagation(formula, assignment, &conflict) == UIP_CONFLICT) {
+        return false;
+    }
+
+    LocalSearch* search = create_local_search(formula, assignment);
+    for (int var = 0; var < search->num_variables; var++) {
+        search->value[var] = next_random(assignment) >> 63;
+    }
+    bool model = walk(search, assignment, SLS_STANDALONE_FLIPS);
+    assignment->sls_rounds++;
+    if (model) {
+        // the free variables become decisions of a single level
+        new_decision_level(assignment);
+        for (int var = 0; var < search->num_variables; var++) {
+            if (!variable_assigned(assignment, var)) {
+                assign_literal(assignment, make_lit(var, !search->value[var]), ANTECEDENT_CLAUSE_NONE);
+            }
+        }
+    } else {
+        assignment->interrupted = true;
+    }
+    free_local_search(search);
+    return model;
+}
@@ -4,22 +4,12 @@
 bool is_satisfied(Formula* formula, Assignment* assignment) {
     // A formula is satisfied if all clauses are satisfied
     for (int i = 0; i < formula->size; i++) {
-        Clause* clause = &formula->clauses[i];
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
         bool clause_satisfied = false;
         
         // A clause is satisfied if at least one literal is satisfied
-        for (int j = 0; j < clause->size; j++) {
-            Literal lit = clause->literals[j];
-            int var = abs(lit);
-            bool is_positive = (lit > 0);
-            
-            if (assignment->assigned[var - 1]) {
-                bool var_value = assignment->values[var - 1];
-                if ((is_positive && var_value) || (!is_positive && !var_value)) {
-                    clause_satisfied = true;
-                    break;
-                }
-            }
+        for (int j = 0; j < (int)clause->size; j++) {
+            clause_satisfied |= literal_value(assignment, clause->literals[j]) == LITERAL_TRUE;
         }
         
         if (!clause_satisfied) {
@@ -31,87 +21,438 @@ bool is_satisfied(Formula* formula, Assignment* assignment) {
 }
 
 bool all_variables_assigned(Assignment* assignment, Formula* formula){
-    for (int i = 0; i < formula->num_variables; i++){
-        if (!assignment->assigned[i]){
-            return false;
-        }
-    }
-    return true;
+    return assignment->trail_size == formula->num_variables;
 }
 
 // Entry point for solving
 bool solve(Formula* formula, Assignment* assignment) {
+    if (assignment->options.sls == SLS_ONLY) {
+        return solve_local_search(formula, assignment);
+    }
     return solve_dpll(formula, assignment);
 }
 
+// Solve under assumptions: literals decided first, in order, before any
+// other decision. Returns false if the formula is unsatisfiable, or if it is
+// unsatisfiable under the assumptions (then assumption_failed is set).
+// Learned clauses do not depend on the assumptions and stay valid for
+// later calls with the same formula and assignment.
+bool solve_assuming(Formula* formula, Assignment* assignment, const Lit* assumptions, int size) {
+    assignment->assumptions = assumptions;
+    assignment->num_assumptions = size;
+    bool result = solve_dpll(formula, assignment);
+    assignment->assumptions = NULL;
+    assignment->num_assumptions = 0;
+    return result;
+}
 
-// Unit propagation: find and assign all unit clauses
-int unit_propagation(Formula* formula, Assignment* assignment, Clause** conflict_clause) {
-    bool end_propagation = false;
 
-    // loop finishes, after no more unit/conflict clauses are found
-    do {
-        end_propagation = true;
-        
-        for (int i = 0; i < formula->size; i++) {
-            Clause* clause = &formula->clauses[i];
-            int status = clause_status(clause, assignment);
-            if(status == CLAUSE_SAT || status == CLAUSE_UNRESOLVED){
-                // goes to next clause in formula
+// Assign lit to true at the current depth and push it on the trail
+void assign_literal(Assignment* assignment, Lit lit, ClauseRef antecedent) {
+    int var = lit_var(lit);
+    assignment->values[lit] = LITERAL_TRUE;
+    assignment->values[lit_negate(lit)] = LITERAL_FALSE;
+    assignment->vars[var].level = assignment->current_depth_level;
+    assignment->vars[var].reason = antecedent;
+    assignment->trail[assignment->trail_size++] = lit;
+}
+
+// Open a new decision level, remembering where it starts on the trail
+void new_decision_level(Assignment* assignment) {
+    assignment->trail_lim[assignment->current_depth_level] = assignment->trail_size;
+    assignment->current_depth_level++;
+}
+
+// Unit propagation: visit the watch lists of every trail literal not yet propagated.
+// Binary implications are read straight from the watch and go first, since
+// they are the cheapest and the most likely to end in a conflict. Other
+// clauses watch their first two literals; when one of them becomes false we
+// look for a replacement, and if there is none the clause is either unit
+// (the other watch gets assigned) or conflicting. Ternary watches carry the
+// two other literals, so a satisfied ternary clause is skipped unread.
+int unit_propagation(Formula* formula, Assignment* assignment, ClauseRef* conflict_clause) {
+    while (assignment->propagation_head < assignment->trail_size) {
+        Lit false_lit = lit_negate(assignment->trail[assignment->propagation_head++]);
+        assignment->propagations++;
+        WatchList* watch_list = &formula->watches[false_lit];
+
+        for (int b = 0; b < watch_list->num_binaries; b++) {
+            BinaryWatch watch = watch_list->binaries[b];
+            int value = literal_value(assignment, watch.implied);
+            if (value == LITERAL_UNASSIGNED) {
+                assign_literal(assignment, watch.implied, watch.clause);
+            } else if (value == LITERAL_FALSE) {
+                *conflict_clause = watch.clause;
+                return UIP_CONFLICT;
+            }
+        }
+
+        int t = 0, u = 0;
+        while (t < watch_list->num_ternaries) {
+            TernaryWatch watch = watch_list->ternaries[t++];
+            if (literal_value(assignment, watch.other[0]) == LITERAL_TRUE
+                || literal_value(assignment, watch.other[1]) == LITERAL_TRUE) {
+                watch_list->ternaries[u++] = watch;
+                continue;
+            }
+            Lit* literals = clause_at(formula, watch.clause)->literals;
+            if (literals[0] == false_lit) {
+                literals[0] = literals[1];
+                literals[1] = false_lit;
+            }
+            // the third literal takes over the watch
+            if (literal_value(assignment, literals[2]) != LITERAL_FALSE) {
+                literals[1] = literals[2];
+                literals[2] = false_lit;
+                add_ternary_watch(&formula->watches[literals[1]], literals[0], false_lit, watch.clause);
                 continue;
-            }else if(status == CLAUSE_UNIT){
-                // find unit literal and assign it
-                for (int j = 0; j < clause->size; j++){
-                    Literal lit = clause->literals[j];
-                    int var = abs(lit);
-                    if(!assignment->assigned[var-1]){
-                        assignment->assigned[var-1] = true;
-                        assignment->values[var-1] = (lit > 0);
-                        assignment->depth[var-1] = assignment->current_depth_level;
-                        assignment->antecedent_clause[var-1] = i;
-                        end_propagation = false;
-                        break;
-                    }   
+            }
+            watch_list->ternaries[u++] = watch;
+            if (literal_value(assignment, literals[0]) == LITERAL_FALSE) {
+                while (t < watch_list->num_ternaries) {
+                    watch_list->ternaries[u++] = watch_list->ternaries[t++];
                 }
-            }else{
-                // this is CLAUSE_CONFLICT
-                *conflict_clause = clause;
+                watch_list->num_ternaries = u;
+                *conflict_clause = watch.clause;
                 return UIP_CONFLICT;
             }
+            assign_literal(assignment, literals[0], watch.clause);
         }
-    } while (!end_propagation);
-    
+        watch_list->num_ternaries = u;
+
+        int i = 0, j = 0;
+
+        while (i < watch_list->size) {
+            ClauseRef clause_index = watch_list->clauses[i++];
+            StoredClause* clause = clause_at(formula, clause_index);
+            Lit* literals = clause->literals;
+
+            // keep the false literal in the second watched position
+            if (literals[0] == false_lit) {
+                literals[0] = literals[1];
+                literals[1] = false_lit;
+            }
+
+            // clause is already satisfied by the other watch
+            if (literal_value(assignment, literals[0]) == LITERAL_TRUE) {
+                watch_list->clauses[j++] = clause_index;
+                continue;
+            }
+
+            // look for a new literal to watch
+            bool moved = false;
+            for (int k = 2; k < (int)clause->size; k++) {
+                if (literal_value(assignment, literals[k]) != LITERAL_FALSE) {
+                    literals[1] = literals[k];
+                    literals[k] = false_lit;
+                    add_watch(&formula->watches[literals[1]], clause_index);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) {
+                continue;
+            }
+
+            // no replacement: the clause stays watched and is unit or conflicting
+            watch_list->clauses[j++] = clause_index;
+            if (literal_value(assignment, literals[0]) == LITERAL_FALSE) {
+                while (i < watch_list->size) {
+                    watch_list->clauses[j++] = watch_list->clauses[i++];
+                }
+                watch_list->size = j;
+                *conflict_clause = clause_index;
+                return UIP_CONFLICT;
+            }
+            assign_literal(assignment, literals[0], clause_index);
+        }
+        watch_list->size = j;
+    }
+
     return UIP_UNRESOLVED;
 }
 
+// Default search parameters
+SolverOptions default_solver_options() {
+    SolverOptions options;
+    options.decision_heuristic = HEURISTIC_VSIDS;
+    options.activity_decay = 0.95;
+    options.polarity = POLARITY_SAVED;
+    options.seed = 0;
+    options.restart_policy = RESTART_GLUCOSE;
+    options.restart_unit = 100;
+    options.threads = 1;
+    options.share = true;
+    options.share_max_size = SHARE_MAX_SIZE;
+    options.share_max_lbd = SHARE_MAX_LBD;
+    options.cube_depth = 0;
+    options.preprocess = true;
+    options.probe = true;
+    options.sls = SLS_HYBRID;
+    options.stats = STATS_NONE;
+    options.progress = 0;
+    return options;
+}
+
+// Increase the activity of a variable (0-based) that took part in a conflict
+void bump_variable_activity(Assignment* assignment, int var) {
+    assignment->activity[var] += assignment->activity_increment;
+    if (assignment->activity[var] > 1e100) {
+        // rescale everything, the relative order is all that matters
+        for (int i = 0; i < assignment->size; i++) {
+            assignment->activity[i] *= 1e-100;
+        }
+        assignment->activity_increment *= 1e-100;
+    }
+    heap_increase(&assignment->order, var);
+}
+
+// Exponential decay: instead of scaling every activity down, future bumps grow
+void decay_variable_activity(Assignment* assignment) {
+    assignment->activity_increment /= assignment->options.activity_decay;
+}
+
+// xorshift64*, seeded from options.seed when the search starts
+unsigned long long next_random(Assignment* assignment) {
+    unsigned long long x = assignment->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    assignment->random_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Value to give the decision variable var (0-based)
+bool choose_polarity(Assignment* assignment, int var) {
+    switch (assignment->options.polarity) {
+        case POLARITY_FALSE:
+            return false;
+        case POLARITY_TRUE:
+            return true;
+        case POLARITY_RANDOM:
+            return next_random(assignment) >> 63;
+        case POLARITY_TARGET:
+            if (assignment->target_phase[var] != PHASE_UNSET) {
+                return assignment->target_phase[var];
+            }
+            break;
+        case POLARITY_BEST:
+            if (assignment->best_phase[var] != PHASE_UNSET) {
+                return assignment->best_phase[var];
+            }
+            break;
+    }
+    return assignment->saved_phase[var];
+}
+
 // Choose an unassigned variable for branching
 int choose_variable(Formula* formula, Assignment* assignment) {
+    if (assignment->options.decision_heuristic == HEURISTIC_VSIDS) {
+        // assigned variables are removed lazily from the heap
+        int var;
+        while ((var = heap_pop_max(&assignment->order)) >= 0) {
+            if (!variable_assigned(assignment, var)) {
+                Lit lit = make_lit(var, !choose_polarity(assignment, var));
+                assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+                return var + 1;
+            }
+        }
+        return 0; // All variables are assigned
+    }
+
     // i is the index, care not to subtract 1
-    for (int i = 0; i < formula->num_variables; i++) {
-        if (!assignment->assigned[i]) {            
-            assignment->assigned[i] = true;
-            assignment->values[i] = true; // assign true to the variable
-            assignment->depth[i] = assignment->current_depth_level;            
+    for (int i = assignment->next_variable; i < formula->num_variables; i++) {
+        if (!variable_assigned(assignment, i)) {            
+            assignment->next_variable = i + 1;
+            Lit lit = make_lit(i, !choose_polarity(assignment, i));
+            assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
             return i + 1;
         }
     }
     return 0; // All variables are assigned
 }
 
-// DPLL algorithm implementation
+// Another thread may ask the search to give up, see portfolio.c
+bool search_stopped(Assignment* assignment) {
+    if (assignment->stop && atomic_load_explicit(assignment->stop, memory_order_relaxed)) {
+        assignment->interrupted = true;
+        return true;
+    }
+    return false;
+}
+
+// Unit clauses are not watched, so they are assigned at level 0 before the
+// first propagation. Returns false if the formula has an empty or a false unit clause.
+// Level 0 assignments survive later calls on the same assignment, so only
+// the clauses added since the last call are searched.
+bool assign_unit_clauses(Formula* formula, Assignment* assignment) {
+    for (int i = assignment->units_checked; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        if (clause->size == 0) {
+            return false;
+        }
+        if (clause->size == 1) {
+            int value = literal_value(assignment, clause->literals[0]);
+            if (value == LITERAL_FALSE) {
+                return false;
+            }
+            if (value == LITERAL_UNASSIGNED) {
+                assign_literal(assignment, clause->literals[0], formula->clauses[i]);
+            }
+        }
+    }
+    assignment->units_checked = formula->size;
+    return true;
+}
+
+// The assumption failed is false: collect in core the assumptions that
+// imply it, by following the antecedents back from its complement on the
+// trail. Decisions reached that way are assumptions, since no other
+// decision is made before all assumptions are placed.
+static void analyze_final(Formula* formula, Assignment* assignment, Lit failed) {
+    assignment->core_size = 0;
+    assignment->core[assignment->core_size++] = failed;
+    if (assignment->vars[lit_var(failed)].level == 0) {
+        return;
+    }
+    assignment->seen[lit_var(failed)] = true;
+    for (int i = assignment->trail_size - 1; i >= assignment->trail_lim[0]; i--) {
+        int var = lit_var(assignment->trail[i]);
+        if (!assignment->seen[var]) {
+            continue;
+        }
+        assignment->seen[var] = false;
+        if (assignment->vars[var].reason == ANTECEDENT_CLAUSE_NONE) {
+            // the complement of failed itself when both were assumed
+            assignment->core[assignment->core_size++] = assignment->trail[i];
+            continue;
+        }
+        StoredClause* reason = clause_at(formula, assignment->vars[var].reason);
+        for (int j = 0; j < (int)reason->size; j++) {
+            int other = lit_var(reason->literals[j]);
+            if (other != var && assignment->vars[other].level > 0) {
+                assignment->seen[other] = true;
+            }
+        }
+    }
+}
+
+// The search refuted the assumption failed rather than the formula
+static bool fail_assumption(Formula* formula, Assignment* assignment, Lit failed) {
+    assignment->assumption_failed = true;
+    analyze_final(formula, assignment, failed);
+    return false;
+}
+
+// The assumptions hold in a complete assignment; if one is false it is
+// implied false by the formula and the assumptions before it
+static bool assumptions_hold(Formula* formula, Assignment* assignment) {
+    for (int i = 0; i < assignment->num_assumptions; i++) {
+        if (literal_value(assignment, assignment->assumptions[i]) != LITERAL_TRUE) {
+            return fail_assumption(formula, assignment, assignment->assumptions[i]);
+        }
+    }
+    return true;
+}
+
+// DPLL algorithm implementation. May be called again on the same formula
+// and assignment (e.g. with other assumptions): the search then restarts
+// from level 0 and keeps what it learned.
 bool solve_dpll(Formula* formula, Assignment* assignment) {
-    Clause* conflict_clause = create_clause();
+    ClauseRef conflict_clause = CLAUSE_REF_NONE;
+
+    backtrack_assignment(assignment, 0);
+    assignment->interrupted = false;
+    assignment->assumption_failed = false;
+    assignment->core_size = 0;
+    init_watches(formula);
+    // xorshift needs a non-zero state
+    if (assignment->options.seed) {
+        assignment->random_state = assignment->options.seed;
+    }
+    init_restarts(&assignment->restart, &assignment->options);
+    if (assignment->options.progress){
+        assignment->search_start = stats_clock();
+    }
+
+    if (!assign_unit_clauses(formula, assignment)) {
+        return false;
+    }
  
     // Apply unit propagation
     if (unit_propagation(formula, assignment, &conflict_clause) == UIP_CONFLICT) {
-        printf("Unit propagation failed on first run\n");
         return false;
     }
+    if (assignment->options.sls == SLS_HYBRID && assignment->sls_rounds == 0){
+        local_search_phases(formula, assignment, (long long)SLS_INITIAL_FLIPS * formula->size);
+        assignment->sls_propagations = assignment->propagations;
+    }
     
+    bool restart = false;
     while (!all_variables_assigned(assignment, formula)){
-        // Choose an unassigned literal and assign it true
-        assignment->current_depth_level++;
-        int var = choose_variable(formula, assignment);
+        if (search_stopped(assignment)){
+            return false;
+        }
+        // restarts keep the learned clauses and only drop the decisions
+        if (restart){
+            backtrack_assignment(assignment, 0);
+            assignment->target_size = 0;
+            restart_done(&assignment->restart, &assignment->options);
+            restart = false;
+            if (unit_propagation(formula, assignment, &conflict_clause) == UIP_CONFLICT){
+                return false;
+            }
+            if (assignment->options.probe && assignment->conflicts >= assignment->next_probe){
+                long long budget = (long long)(PROBE_EFFORT * (assignment->propagations - assignment->probe_propagations));
+                if (!probe_failed_literals(formula, assignment, budget)){
+                    return false;
+                }
+                assignment->next_probe = assignment->conflicts + PROBE_INTERVAL;
+                assignment->probe_propagations = assignment->propagations;
+            }
+            if (assignment->options.sls == SLS_HYBRID && assignment->conflicts >= assignment->next_sls){
+                long long flips = (long long)(SLS_EFFORT * (assignment->propagations - assignment->sls_propagations));
+                local_search_phases(formula, assignment, flips);
+                assignment->next_sls = assignment->conflicts + SLS_INTERVAL;
+                assignment->sls_propagations = assignment->propagations;
+            }
+            if (all_variables_assigned(assignment, formula)){
+                break;
+            }
+        }
+        // level 0 (after a restart or a learned unit) is where other threads' clauses come in
+        if (assignment->exchange && assignment->current_depth_level == 0){
+            if (!import_clauses(formula, assignment)
+                || unit_propagation(formula, assignment, &conflict_clause) == UIP_CONFLICT){
+                return false;
+            }
+            if (all_variables_assigned(assignment, formula)){
+                break;
+            }
+        }
+
+        if (assignment->conflicts >= assignment->next_reduce){
+            reduce_learned_clauses(formula, assignment);
+            assignment->next_reduce = assignment->conflicts + REDUCE_FIRST + REDUCE_INCREMENT * assignment->reductions;
+        }
+
+        // Assumptions are decided first, one per level. One that is already
+        // true gets an empty level, so level d always holds assumption d.
+        new_decision_level(assignment);
+        if (assignment->current_depth_level <= assignment->num_assumptions){
+            Lit lit = assignment->assumptions[assignment->current_depth_level - 1];
+            int value = literal_value(assignment, lit);
+            if (value == LITERAL_FALSE){
+                return fail_assumption(formula, assignment, lit);
+            }
+            if (value == LITERAL_UNASSIGNED){
+                assign_literal(assignment, lit, ANTECEDENT_CLAUSE_NONE);
+            }
+        } else {
+            // Choose an unassigned literal and assign it true
+            choose_variable(formula, assignment);
+            assignment->decisions++;
+        }
 
             while (true){
                 int reason = unit_propagation(formula, assignment, &conflict_clause);
@@ -119,6 +460,9 @@ bool solve_dpll(Formula* formula, Assignment* assignment) {
                     // no conflict after UIP, so return to branching
                     break;
                 }
+                if (search_stopped(assignment)){
+                    return false;
+                }
                 int b = conflict_analysis(formula, conflict_clause, assignment);
 
                 // if conflict was 'backpropagated' to the root,
@@ -126,142 +470,302 @@ bool solve_dpll(Formula* formula, Assignment* assignment) {
                 if ( b < 0 ){
                     return false;
                 }
+                ClauseRef learned_ref = formula->learned[formula->num_learned - 1];
+                StoredClause* learned = clause_at(formula, learned_ref);
+                if (restart_due(&assignment->restart, &assignment->options, learned->lbd)){
+                    restart = true;
+                }
+                if (assignment->options.progress && assignment->conflicts % assignment->options.progress == 0){
+                    print_progress(formula, assignment);
+                }
 
+                // the first literal of the learned clause is the only one left
+                // unassigned after backjumping
+                STAT_ADD(assignment->backjump_levels, assignment->current_depth_level - b);
                 backtrack_assignment(assignment, b);
-                assignment->current_depth_level = b;
+                assign_literal(assignment, learned->literals[0], learned_ref);
             }
     } 
     // SAT found
     //print_assignment(assignment); -> this is in main() too
-    return true;
+    return assumptions_hold(formula, assignment);
     
 }
 
-Clause* resolve_clauses(Clause* clause_a, Clause* clause_b, Literal literal){
-
-    // since we are using add_literal, the resolution clause will have a meaningful size
-    Clause* resolution = create_clause();
-    if(!resolution){
-        perror("Failed to allocate memory for resolution");
-        exit(EXIT_FAILURE);
+// A learned clause taking part in conflict analysis gets an activity bump,
+// is marked as used and may get a better LBD under the current assignment
+static void update_used_clause(Formula* formula, Assignment* assignment, StoredClause* clause){
+    if (!clause->learned){
+        return;
     }
-    int size_of_resolution = 0;
-    for (int i = 0; i < clause_a->size; i++){
-        if (clause_a->literals[i] != literal && clause_a->literals[i] != -literal){
-            add_literal(resolution, clause_a->literals[i]);
-            size_of_resolution++;
+    bump_clause_activity(assignment, formula, clause);
+    clause->used = true;
+    if (clause->imported){
+        clause->imported = false;
+        assignment->shared_used++;
+    }
+    if (clause->lbd > CORE_LBD){
+        int lbd = compute_lbd(clause->literals, clause->size, assignment);
+        if (lbd < (int)clause->lbd){
+            clause->lbd = lbd;
         }
     }
-    for (int i = 0; i < clause_b->size; i++){
-        if (clause_b->literals[i] != literal && clause_b->literals[i] != -literal && clause_b->literals[i] != 0){
-            // check if the literal already exists in the resolution
-            bool already_in_resolution = false;
-            for (int j = 0; j < size_of_resolution; j++){
-                if (resolution->literals[j] == clause_b->literals[i]){
-                    already_in_resolution = true;
-                    break;
-                }
+}
+
+// One bit per decision level (modulo 32), to cheaply rule out literals whose
+// level does not occur in the learned clause
+static unsigned int abstract_level(Assignment* assignment, int var){
+    return 1u << (assignment->vars[var].level & 31);
+}
+
+// A literal of the learned clause is redundant if it is implied by the other
+// literals, i.e. every path through the antecedents ends in seen literals.
+// Literals proven redundant stay marked seen and are recorded in analyze_clear.
+static bool literal_redundant(Formula* formula, Assignment* assignment, Lit lit, unsigned int levels){
+    int stack_size = 0;
+    int clear_top = assignment->analyze_clear_size;
+    assignment->analyze_stack[stack_size++] = lit;
+
+    while (stack_size > 0){
+        Lit current = assignment->analyze_stack[--stack_size];
+        StoredClause* reason = clause_at(formula, assignment->vars[lit_var(current)].reason);
+        for (int i = 0; i < (int)reason->size; i++){
+            Lit q = reason->literals[i];
+            int var = lit_var(q);
+            if (var == lit_var(current) || assignment->seen[var] || assignment->vars[var].level == 0){
+                continue;
             }
-            if (!already_in_resolution){
-                add_literal(resolution, clause_b->literals[i]);
-                // since we are not parsing size, we don't need to increment
-                // size_of_resolution++;
+            if (assignment->vars[var].reason != ANTECEDENT_CLAUSE_NONE
+                && (abstract_level(assignment, var) & levels) != 0){
+                assignment->seen[var] = true;
+                assignment->analyze_stack[stack_size++] = q;
+                assignment->analyze_clear[assignment->analyze_clear_size++] = q;
+            } else {
+                // reached a decision or a level not in the clause: undo this attempt
+                for (int j = clear_top; j < assignment->analyze_clear_size; j++){
+                    assignment->seen[lit_var(assignment->analyze_clear[j])] = false;
+                }
+                assignment->analyze_clear_size = clear_top;
+                return false;
             }
         }
     }
-    return resolution;
+    return true;
 }
 
-int conflict_analysis(Formula* formula, Clause* clause, Assignment* assignment){
+// First-UIP conflict analysis. Walks the trail backwards from the conflict,
+// resolving on the literals of the current depth until only one (the UIP)
+// is left. The learned clause is then minimized against the antecedents of
+// its literals and stored with the UIP first and a literal of the backjump
+// level second. Returns the backjump level, or -1 if the conflict is at the root.
+int conflict_analysis(Formula* formula, ClauseRef conflict, Assignment* assignment){
     if (assignment->current_depth_level == 0){
         return (-1);
     }
-    // find the literals with assignment on this decision level
-    Literal* literals_at_current_depth = (Literal*)malloc(sizeof(Literal) * clause->size);
-    if(!literals_at_current_depth){
-        perror("Failed to allocate memory for literals_at_current_depth");
-        exit(EXIT_FAILURE);
-    }
-    int count=0;
-    // collect the literals that are assigned at the current depth
-    for (int i = 0; i < clause->size; i++){
-        if (assignment->depth[abs(clause->literals[i])-1] == assignment->current_depth_level){
-            literals_at_current_depth[count] = clause->literals[i];
-            count++;
-        }
-    }
-
-    // select any literal on the current depth level
-    Clause* learned_clause = create_clause();
-    learned_clause = clause;
-    //printf("assignment when calculating backtrack level: ");
-    //print_assignment(assignment);
-    while (count > 1 ) {
-        // Filter for implied literals
-        int i;
-        // pick any literal that is implied
-        for (i = 0; i < count; i++) {
-            if (assignment->antecedent_clause[abs(literals_at_current_depth[i])-1] != ANTECEDENT_CLAUSE_NONE){
-                break;
+    assignment->conflicts++;
+
+    Lit* learned = assignment->learned_buffer;
+    int size = 1; // room for the UIP
+
+    int paths = 0; // literals of the current depth still to resolve on
+    int index = assignment->trail_size - 1;
+    Lit pivot = 0;
+    bool have_pivot = false;
+    StoredClause* reason = clause_at(formula, conflict);
+    do {
+        update_used_clause(formula, assignment, reason);
+        for (int i = 0; i < (int)reason->size; i++){
+            Lit q = reason->literals[i];
+            int var = lit_var(q);
+            if ((have_pivot && var == lit_var(pivot)) || assignment->seen[var] || assignment->vars[var].level == 0){
+                continue;
+            }
+            assignment->seen[var] = true;
+            bump_variable_activity(assignment, var);
+            if (assignment->vars[var].level >= assignment->current_depth_level){
+                paths++;
+            } else {
+                learned[size++] = q;
             }
         }
 
+        // next literal of the current depth to resolve on, in trail order
+        while (!assignment->seen[lit_var(assignment->trail[index])]){
+            index--;
+        }
+        pivot = assignment->trail[index--];
+        have_pivot = true;
+        assignment->seen[lit_var(pivot)] = false;
+        paths--;
+        if (paths > 0){
+            reason = clause_at(formula, assignment->vars[lit_var(pivot)].reason);
+        }
+    } while (paths > 0);
+    learned[0] = lit_negate(pivot);
 
-        Literal literal = literals_at_current_depth[i];
-        Clause antecedent = formula->clauses[assignment->antecedent_clause[abs(literal)-1]];
-
-        learned_clause = resolve_clauses(learned_clause, &antecedent, literal);
+    // drop the literals implied by the rest of the clause
+    assignment->analyze_clear_size = 0;
+    unsigned int levels = 0;
+    for (int i = 1; i < size; i++){
+        levels |= abstract_level(assignment, lit_var(learned[i]));
+    }
+    int kept = 1;
+    for (int i = 1; i < size; i++){
+        Lit lit = learned[i];
+        if (assignment->vars[lit_var(lit)].reason == ANTECEDENT_CLAUSE_NONE
+            || !literal_redundant(formula, assignment, lit, levels)){
+            learned[kept++] = lit;
+        } else {
+            assignment->analyze_clear[assignment->analyze_clear_size++] = lit;
+        }
+    }
+    STAT_ADD(assignment->minimized_literals, size - kept);
+    size = kept;
+    for (int i = 1; i < size; i++){
+        assignment->seen[lit_var(learned[i])] = false;
+    }
+    for (int i = 0; i < assignment->analyze_clear_size; i++){
+        assignment->seen[lit_var(assignment->analyze_clear[i])] = false;
+    }
 
-        // Rebuild temp with new clause
-        count = 0;
-        for (int i = 0; i < learned_clause->size; i++) {
-            if (assignment->depth[abs(learned_clause->literals[i])-1] == assignment->current_depth_level) {
-                literals_at_current_depth[count] = learned_clause->literals[i];
-                count++;
+    // backjump level: the highest level after the UIP's, found in one pass
+    int backtrack_level = 0;
+    if (size > 1){
+        int max_index = 1;
+        for (int i = 2; i < size; i++){
+            if (assignment->vars[lit_var(learned[i])].level > assignment->vars[lit_var(learned[max_index])].level){
+                max_index = i;
             }
         }
+        Lit lit = learned[max_index];
+        learned[max_index] = learned[1];
+        learned[1] = lit;
+        backtrack_level = assignment->vars[lit_var(lit)].level;
     }
 
-    add_clause(formula, learned_clause);
+    decay_variable_activity(assignment);
+    assignment->clause_activity_increment /= CLAUSE_ACTIVITY_DECAY;
 
-    int* deision_levels = (int*)malloc(sizeof(int) * learned_clause->size);
-    for (int i = 0; i < learned_clause->size; i++){
-        deision_levels[i] = assignment->depth[abs(learned_clause->literals[i])-1];
-    }
-    if (learned_clause->size <=1){
-        return 0;
-    } else{
-        // return second largest decision level
-        return getSecondLargest(deision_levels, learned_clause->size);
+    int lbd = compute_lbd(learned, size, assignment);
+    STAT_ADD(assignment->learned_clauses, 1);
+    STAT_ADD(assignment->learned_literals, size);
+    STAT_ADD(assignment->learned_lbd, lbd);
+    if (assignment->exchange){
+        export_clause(assignment, learned, size, lbd);
     }
+    add_learned_clause(formula, learned, size, lbd);
+    return backtrack_level;
 }
 
 
+// Literal block distance: number of distinct decision levels in the clause
+int compute_lbd(const Lit* literals, int size, Assignment* assignment){
+    assignment->lbd_stamp++;
+    int lbd = 0;
+    for (int i = 0; i < size; i++){
+        int level = assignment->vars[lit_var(literals[i])].level;
+        if (assignment->level_stamp[level] != assignment->lbd_stamp){
+            assignment->level_stamp[level] = assignment->lbd_stamp;
+            lbd++;
+        }
+    }
+    return lbd;
+}
+
 //check if clause is unit, sat, unsat or unresolved
-int clause_status(Clause* clause, Assignment* assignment){
+int clause_status(StoredClause* clause, Assignment* assignment){
     int total_assigned =0;
-    for (int i = 0; i < clause->size; i++){
-        int literal = clause->literals[i];
-        bool is_assigned = assignment->assigned[abs(literal)-1];
-        bool literal_value = assignment->values[abs(literal)-1];
-        total_assigned = total_assigned + is_assigned;
-
-        // check if the literal in the clause is assigned and is set to True
-        if(is_assigned == true && \
-        ((literal > 0 && literal_value == true) || \
-        (literal < 0 && literal_value == false)) ){
-            return CLAUSE_SAT;
-        }
+    int total_true = 0;
+    int size = clause->size;
+    // counted without branching on the values
+    for (int i = 0; i < size; i++){
+        int value = literal_value(assignment, clause->literals[i]);
+        total_assigned += value != LITERAL_UNASSIGNED;
+        total_true += value == LITERAL_TRUE;
+    }
+    if(total_true > 0){
+        return CLAUSE_SAT;
     }
-    if(total_assigned == clause->size){
+    if(total_assigned == size){
         return CLAUSE_UNSAT;
-    }else if(total_assigned == clause->size-1){
+    }else if(total_assigned == size-1){
         return CLAUSE_UNIT;
     }else{
         return CLAUSE_UNRESOLVED;
     }
 }
 
+// Bring an assignment back to its initial state for a formula with
+// num_variables variables, which must fit in its capacity
+static void reset_assignment(Assignment* assignment, int num_variables){
+    assignment->size = num_variables;
+    memset(assignment->values, LITERAL_UNASSIGNED, 2 * num_variables);
+    memset(assignment->activity, 0, num_variables * sizeof(double));
+    memset(assignment->saved_phase, 0, num_variables * sizeof(bool));
+    memset(assignment->level_stamp, 0, (num_variables + 1) * sizeof(int));
+    memset(assignment->seen, 0, num_variables * sizeof(bool));
+    for(int i = 0; i < num_variables; i++){
+        assignment->vars[i].level = 0;
+        assignment->vars[i].reason = ANTECEDENT_CLAUSE_NONE;
+        assignment->target_phase[i] = PHASE_UNSET;
+        assignment->best_phase[i] = PHASE_UNSET;
+    }
+    assignment->target_size = 0;
+    assignment->best_size = 0;
+    assignment->current_depth_level = 0;
+    assignment->trail_size = 0;
+    assignment->propagation_head = 0;
+    assignment->next_variable = 0;
+    assignment->units_checked = 0;
+    assignment->activity_increment = 1.0;
+    assignment->options = default_solver_options();
+    assignment->random_state = 0x9E3779B97F4A7C15ULL;
+    assignment->lbd_stamp = 0;
+    init_restarts(&assignment->restart, &assignment->options);
+    assignment->conflicts = 0;
+    assignment->decisions = 0;
+    assignment->propagations = 0;
+    assignment->next_reduce = REDUCE_FIRST;
+    assignment->reductions = 0;
+    assignment->clause_activity_increment = 1.0f;
+    assignment->analyze_clear_size = 0;
+    assignment->stop = NULL;
+    assignment->interrupted = false;
+    assignment->assumptions = NULL;
+    assignment->num_assumptions = 0;
+    assignment->assumption_failed = false;
+    assignment->core_size = 0;
+    free(assignment->import_cursor);
+    assignment->exchange = NULL;
+    assignment->exchange_id = 0;
+    assignment->import_cursor = NULL;
+    assignment->shared_exported = 0;
+    assignment->shared_imported = 0;
+    assignment->shared_used = 0;
+    assignment->shared_dropped = 0;
+    assignment->next_probe = PROBE_INTERVAL;
+    assignment->probe_propagations = 0;
+    assignment->probe_cursor = 0;
+    assignment->failed_literals = 0;
+    assignment->implied_literals = 0;
+    assignment->next_sls = SLS_INTERVAL;
+    assignment->sls_propagations = 0;
+    assignment->sls_flips = 0;
+    assignment->sls_rounds = 0;
+    assignment->learned_clauses = 0;
+    assignment->learned_literals = 0;
+    assignment->learned_lbd = 0;
+    assignment->minimized_literals = 0;
+    assignment->backjump_levels = 0;
+    assignment->search_start = 0;
+
+    // with equal activities the heap starts out in variable order
+    clear_heap(&assignment->order, num_variables);
+    for(int i = 0; i < num_variables; i++){
+        heap_insert(&assignment->order, i);
+    }
+}
+
 // Create a new assignment
 Assignment* create_assignment(int num_variables) {
     Assignment* assignment = (Assignment*)malloc(sizeof(Assignment));
@@ -270,53 +774,164 @@ Assignment* create_assignment(int num_variables) {
         exit(EXIT_FAILURE);
     }
     
-    assignment->values = (bool*)calloc(num_variables, sizeof(bool));
-    assignment->assigned = (bool*)calloc(num_variables, sizeof(bool));
-    assignment->depth = (int*)calloc(num_variables, sizeof(int));
-    assignment->antecedent_clause = (int*)calloc(num_variables, sizeof(int));
+    assignment->values = (unsigned char*)malloc(2 * num_variables);
+    assignment->vars = (VariableInfo*)calloc(num_variables, sizeof(VariableInfo));
+    assignment->trail = (Lit*)calloc(num_variables, sizeof(Lit));
+    assignment->trail_lim = (int*)calloc(num_variables + 1, sizeof(int));
+    assignment->activity = (double*)calloc(num_variables, sizeof(double));
+    assignment->saved_phase = (bool*)calloc(num_variables, sizeof(bool));
+    assignment->target_phase = (signed char*)malloc(num_variables * sizeof(signed char));
+    assignment->best_phase = (signed char*)malloc(num_variables * sizeof(signed char));
+    assignment->level_stamp = (int*)calloc(num_variables + 1, sizeof(int));
+    assignment->seen = (bool*)calloc(num_variables, sizeof(bool));
+    assignment->analyze_stack = (Lit*)malloc(num_variables * sizeof(Lit));
+    assignment->analyze_clear = (Lit*)malloc(num_variables * sizeof(Lit));
+    assignment->learned_buffer = (Lit*)malloc((num_variables + 1) * sizeof(Lit));
+    assignment->core = (Lit*)malloc((num_variables + 1) * sizeof(Lit));
 
-    if (!assignment->values || !assignment->assigned || !assignment->depth || !assignment->antecedent_clause) {
+    if (!assignment->values || !assignment->vars || !assignment->trail || !assignment->trail_lim
+        || !assignment->activity || !assignment->saved_phase
+        || !assignment->target_phase || !assignment->best_phase || !assignment->level_stamp
+        || !assignment->seen || !assignment->analyze_stack || !assignment->analyze_clear
+        || !assignment->learned_buffer || !assignment->core) {
         perror("Failed to allocate memory for assignment arrays");
         exit(EXIT_FAILURE);
     }
     
-    assignment->size = num_variables;
-    for(int i = 0; i < num_variables; i++){
-        assignment->depth[i] = 0;
-        assignment->antecedent_clause[i] = ANTECEDENT_CLAUSE_NONE;
+    assignment->capacity = num_variables;
+    assignment->import_cursor = NULL;
+    init_heap(&assignment->order, num_variables, assignment->activity);
+    reset_assignment(assignment, num_variables);
+    return assignment;
+}
+
+// Reuse an assignment for a new formula, reallocating only if it has more
+// variables than any formula before. Returns the assignment to use.
+Assignment* recycle_assignment(Assignment* assignment, int num_variables){
+    if (!assignment || num_variables > assignment->capacity){
+        if (assignment){
+            free_assignment(assignment);
+        }
+        return create_assignment(num_variables);
     }
-    assignment->current_depth_level = 0;
+    reset_assignment(assignment, num_variables);
     return assignment;
 }
 
-// backtrack an assignment to decision level
+static void* grow_array(void* array, size_t size, const char* what){
+    array = realloc(array, size);
+    if (!array){
+        fprintf(stderr, "Failed to reallocate memory for %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+// Add unassigned variables up to num_variables, keeping the state of the
+// existing ones (trail, activities, phases). Arrays grow geometrically.
+void grow_assignment(Assignment* assignment, int num_variables){
+    int old_size = assignment->size;
+    if (num_variables <= old_size){
+        return;
+    }
+    if (num_variables > assignment->capacity){
+        int capacity = assignment->capacity * 2 > num_variables ? assignment->capacity * 2 : num_variables;
+        assignment->values = (unsigned char*)grow_array(assignment->values, 2 * capacity, "values");
+        assignment->vars = (VariableInfo*)grow_array(assignment->vars, capacity * sizeof(VariableInfo), "variable levels and reasons");
+        assignment->trail = (Lit*)grow_array(assignment->trail, capacity * sizeof(Lit), "trail");
+        assignment->trail_lim = (int*)grow_array(assignment->trail_lim, (capacity + 1) * sizeof(int), "trail limits");
+        assignment->activity = (double*)grow_array(assignment->activity, capacity * sizeof(double), "activities");
+        assignment->saved_phase = (bool*)grow_array(assignment->saved_phase, capacity * sizeof(bool), "saved phases");
+        assignment->target_phase = (signed char*)grow_array(assignment->target_phase, capacity, "target phases");
+        assignment->best_phase = (signed char*)grow_array(assignment->best_phase, capacity, "best phases");
+        assignment->level_stamp = (int*)grow_array(assignment->level_stamp, (capacity + 1) * sizeof(int), "level stamps");
+        assignment->seen = (bool*)grow_array(assignment->seen, capacity * sizeof(bool), "seen marks");
+        assignment->analyze_stack = (Lit*)grow_array(assignment->analyze_stack, capacity * sizeof(Lit), "analysis stack");
+        assignment->analyze_clear = (Lit*)grow_array(assignment->analyze_clear, capacity * sizeof(Lit), "analysis stack");
+        assignment->learned_buffer = (Lit*)grow_array(assignment->learned_buffer, (capacity + 1) * sizeof(Lit), "learned clause buffer");
+        assignment->core = (Lit*)grow_array(assignment->core, (capacity + 1) * sizeof(Lit), "assumption core");
+        grow_heap(&assignment->order, assignment->capacity, capacity, assignment->activity);
+        assignment->capacity = capacity;
+    }
+    for (int i = old_size; i < num_variables; i++){
+        assignment->values[make_lit(i, false)] = LITERAL_UNASSIGNED;
+        assignment->values[make_lit(i, true)] = LITERAL_UNASSIGNED;
+        assignment->vars[i].level = 0;
+        assignment->vars[i].reason = ANTECEDENT_CLAUSE_NONE;
+        assignment->activity[i] = 0;
+        assignment->saved_phase[i] = false;
+        assignment->target_phase[i] = PHASE_UNSET;
+        assignment->best_phase[i] = PHASE_UNSET;
+        assignment->level_stamp[i + 1] = 0;
+        assignment->seen[i] = false;
+    }
+    assignment->size = num_variables;
+    for (int i = old_size; i < num_variables; i++){
+        heap_insert(&assignment->order, i);
+    }
+}
+
+// backtrack an assignment to decision level: the literals assigned above
+// backtrack_level are popped off the trail, the levels up to it stay untouched
 void backtrack_assignment(Assignment* assignment, int backtrack_level){
-    for(int i = 0; i < assignment->size; i++){
-        // reset all assignments after backtrack_level
-        if(assignment->depth[i] > backtrack_level){
-            assignment->values[i] = false;
-            assignment->assigned[i] = false;
-            assignment->antecedent_clause[i] = ANTECEDENT_CLAUSE_NONE;
-            assignment->depth[i] = 0;
-            assignment->current_depth_level = backtrack_level;
-        // for literals assigned at the backtrack_level, we assign the other value
-        }else if(assignment->depth[i] == backtrack_level && assignment->antecedent_clause[i] == ANTECEDENT_CLAUSE_NONE){
-            assignment->values[i] = !assignment->values[i];
-        // free up the implied literals on backtrack_level
-        }else if(assignment->depth[i] == backtrack_level && assignment->antecedent_clause[i] != ANTECEDENT_CLAUSE_NONE){
-            assignment->values[i] = 0;
-            assignment->assigned[i] = false;
-            assignment->antecedent_clause[i] = ANTECEDENT_CLAUSE_NONE;
-            assignment->depth[i] = 0;
+    if (assignment->current_depth_level <= backtrack_level){
+        return;
+    }
+
+    // everything below the last decision was propagated without conflict,
+    // remember it if it is the longest such trail so far
+    int consistent_size = assignment->trail_lim[assignment->current_depth_level - 1];
+    if (consistent_size > assignment->target_size){
+        for (int i = 0; i < consistent_size; i++){
+            Lit lit = assignment->trail[i];
+            assignment->target_phase[lit_var(lit)] = !lit_negated(lit);
+        }
+        assignment->target_size = consistent_size;
+    }
+    if (consistent_size > assignment->best_size){
+        for (int i = 0; i < consistent_size; i++){
+            Lit lit = assignment->trail[i];
+            assignment->best_phase[lit_var(lit)] = !lit_negated(lit);
+        }
+        assignment->best_size = consistent_size;
+    }
+
+    int level_start = assignment->trail_lim[backtrack_level];
+    for(int i = assignment->trail_size - 1; i >= level_start; i--){
+        int var = lit_var(assignment->trail[i]);
+        assignment->saved_phase[var] = !lit_negated(assignment->trail[i]);
+        assignment->values[make_lit(var, false)] = LITERAL_UNASSIGNED;
+        assignment->values[make_lit(var, true)] = LITERAL_UNASSIGNED;
+        assignment->vars[var].reason = ANTECEDENT_CLAUSE_NONE;
+        assignment->vars[var].level = 0;
+        if (var < assignment->next_variable){
+            assignment->next_variable = var;
         }
+        heap_insert(&assignment->order, var);
     }
+    // the remaining assignments were fully propagated before the next decision
+    assignment->trail_size = level_start;
+    assignment->propagation_head = level_start;
+    assignment->current_depth_level = backtrack_level;
 }
 // Free an assignment
 void free_assignment(Assignment* assignment){
     free(assignment->values);
-    free(assignment->assigned);
-    free(assignment->depth);
-    free(assignment->antecedent_clause);
+    free(assignment->vars);
+    free(assignment->trail);
+    free(assignment->trail_lim);
+    free(assignment->activity);
+    free(assignment->saved_phase);
+    free(assignment->target_phase);
+    free(assignment->best_phase);
+    free(assignment->level_stamp);
+    free(assignment->seen);
+    free(assignment->analyze_stack);
+    free(assignment->analyze_clear);
+    free(assignment->learned_buffer);
+    free(assignment->core);
+    free(assignment->import_cursor);
+    free_heap(&assignment->order);
     free(assignment);
 }
 
@@ -333,9 +948,9 @@ void print_clause(Clause* clause) {
 void print_assignment(Assignment* assignment) {
     printf("ASSIGNMENT: ");
     for (int i = 0; i < assignment->size; i++) {
-        if (assignment->assigned[i]) {
-            printf("%d=%s ", i + 1, assignment->values[i] ? "1" : "0");
-            //printf("assigned: %d, depth: %d, antecedent_clause: %d\n", assignment->assigned[i], assignment->depth[i], assignment->antecedent_clause[i]);
+        if (variable_assigned(assignment, i)) {
+            printf("%d=%s ", i + 1, literal_value(assignment, make_lit(i, false)) == LITERAL_TRUE ? "1" : "0");
+            //printf("assigned: %d, depth: %d, antecedent_clause: %d\n", variable_assigned(assignment, i), assignment->vars[i].level, assignment->vars[i].reason);
         } else {
             printf("%d=NOT ASSIGNED " , i + 1);
         }
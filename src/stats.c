@@ -0,0 +1,126 @@
+#include "sat.h"
+#include <time.h>
+
+// Solver statistics: the counters kept by an assignment during the search,
+// printed after solving (--stats) as a block of DIMACS "c" lines or as one
+// JSON object, and a progress line every --progress conflicts. Everything
+// goes to stderr, so the result on stdout keeps its format.
+
+double stats_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double ratio(double a, double b) {
+    return b > 0 ? a / b : 0;
+}
+
+// Variables fixed at level 0
+static int fixed_variables(Assignment* assignment) {
+    return assignment->current_depth_level > 0 ? assignment->trail_lim[0] : assignment->trail_size;
+}
+
+void print_progress(Formula* formula, Assignment* assignment) {
+    fprintf(stderr, "c progress %.2fs: %lld conflicts, %lld decisions, %lld propagations, %d restarts,"
+            " %d learned (avg LBD %.1f), %d fixed, trail %d/%d\n",
+            stats_clock() - assignment->search_start, assignment->conflicts, assignment->decisions,
+            assignment->propagations, assignment->restart.restarts, formula->num_learned,
+            ratio(assignment->learned_lbd, assignment->learned_clauses), fixed_variables(assignment),
+            assignment->trail_size, assignment->size);
+}
+
+static void print_text(FILE* out, const char* result, bool verified, Formula* formula,
+                       Assignment* assignment, const PhaseTimes* times, const PhaseCounters* counters) {
+    double total = times->parse + times->preprocess + times->search + times->verify;
+    fprintf(out, "c ---- statistics ----\n");
+    fprintf(out, "c result:             %s%s\n", result, verified ? " (model verified)" : "");
+    fprintf(out, "c parse time:         %.3f s\n", times->parse);
+    fprintf(out, "c preprocess time:    %.3f s\n", times->preprocess);
+    fprintf(out, "c search time:        %.3f s\n", times->search);
+    fprintf(out, "c verify time:        %.3f s\n", times->verify);
+    fprintf(out, "c total time:         %.3f s\n", total);
+    fprintf(out, "c decisions:          %lld (%.0f/s)\n", assignment->decisions,
+            ratio(assignment->decisions, times->search));
+    fprintf(out, "c propagations:       %lld (%.0f/s)\n", assignment->propagations,
+            ratio(assignment->propagations, times->search));
+    fprintf(out, "c conflicts:          %lld (%.0f/s)\n", assignment->conflicts,
+            ratio(assignment->conflicts, times->search));
+    fprintf(out, "c restarts:           %d\n", assignment->restart.restarts);
+    fprintf(out, "c learned clauses:    %lld, avg size %.1f, avg LBD %.1f, %.1f%% literals minimized away\n",
+            assignment->learned_clauses, ratio(assignment->learned_literals, assignment->learned_clauses),
+            ratio(assignment->learned_lbd, assignment->learned_clauses),
+            100 * ratio(assignment->minimized_literals, assignment->learned_literals + assignment->minimized_literals));
+    fprintf(out, "c backjumps:          avg %.1f levels\n",
+            ratio(assignment->backjump_levels, assignment->learned_clauses));
+    fprintf(out, "c clause database:    %d original, %d learned kept, %d reductions, %u KB arena\n",
+            formula->size, formula->num_learned, assignment->reductions,
+            (unsigned)(formula->arena.size * sizeof(uint32_t) / 1024));
+    fprintf(out, "c fixed variables:    %d of %d\n", fixed_variables(assignment), assignment->size);
+    fprintf(out, "c probing:            %lld failed literals, %lld implied by both values\n",
+            assignment->failed_literals, assignment->implied_literals);
+    fprintf(out, "c local search:       %d rounds, %lld flips\n", assignment->sls_rounds, assignment->sls_flips);
+    if (counters->preprocessed) {
+        fprintf(out, "c preprocessing:      %d of %d clauses removed, %d variables eliminated, %d fixed, "
+                "%d subsumed, %d strengthened\n", counters->clauses_removed, counters->clauses_before,
+                counters->eliminated, counters->fixed, counters->subsumed, counters->strengthened);
+    }
+    if (counters->probed) {
+        fprintf(out, "c initial probing:    %lld failed literals, %lld implied by both values, "
+                "%d equivalent literals substituted, %.3f s\n", counters->failed_literals,
+                counters->implied_literals, counters->substituted, counters->probe_seconds);
+    }
+    if (counters->cubes > 0) {
+        fprintf(out, "c cubes:              %d cubes, %d branches refuted, %d stolen, %.3f s lookahead\n",
+                counters->cubes, counters->refuted_branches, counters->cubes_stolen, counters->lookahead_seconds);
+    }
+    if (counters->shared) {
+        fprintf(out, "c clause sharing:     %d threads, exported %lld, imported %lld, used %lld, dropped %lld\n",
+                counters->threads, counters->exported, counters->imported, counters->used, counters->dropped);
+    }
+}
+
+// One line, so the object is easy to pick out of the other stderr output
+static void print_json(FILE* out, const char* result, bool verified, Formula* formula,
+                       Assignment* assignment, const PhaseTimes* times, const PhaseCounters* counters) {
+    fprintf(out, "{\"result\": \"%s\", \"verified\": %s, ", result, verified ? "true" : "false");
+    fprintf(out, "\"time\": {\"parse\": %.6f, \"preprocess\": %.6f, \"search\": %.6f, \"verify\": %.6f}, ",
+            times->parse, times->preprocess, times->search, times->verify);
+    fprintf(out, "\"decisions\": %lld, \"propagations\": %lld, \"conflicts\": %lld, \"restarts\": %d, ",
+            assignment->decisions, assignment->propagations, assignment->conflicts, assignment->restart.restarts);
+    fprintf(out, "\"learned\": {\"clauses\": %lld, \"literals\": %lld, \"lbd\": %lld, \"minimized_literals\": %lld}, ",
+            assignment->learned_clauses, assignment->learned_literals, assignment->learned_lbd,
+            assignment->minimized_literals);
+    fprintf(out, "\"backjump_levels\": %lld, ", assignment->backjump_levels);
+    fprintf(out, "\"clause_db\": {\"original\": %d, \"learned\": %d, \"reductions\": %d, \"arena_words\": %u}, ",
+            formula->size, formula->num_learned, assignment->reductions, formula->arena.size);
+    fprintf(out, "\"variables\": %d, \"fixed\": %d, ", assignment->size, fixed_variables(assignment));
+    fprintf(out, "\"probing\": {\"failed_literals\": %lld, \"implied_literals\": %lld}, ",
+            assignment->failed_literals, assignment->implied_literals);
+    fprintf(out, "\"local_search\": {\"rounds\": %d, \"flips\": %lld}, ", assignment->sls_rounds, assignment->sls_flips);
+    fprintf(out, "\"preprocess\": {\"enabled\": %s, \"clauses\": %d, \"removed\": %d, \"eliminated\": %d, "
+            "\"fixed\": %d, \"subsumed\": %d, \"strengthened\": %d}, ", counters->preprocessed ? "true" : "false",
+            counters->clauses_before, counters->clauses_removed, counters->eliminated, counters->fixed,
+            counters->subsumed, counters->strengthened);
+    fprintf(out, "\"initial_probing\": {\"enabled\": %s, \"failed_literals\": %lld, \"implied_literals\": %lld, "
+            "\"substituted\": %d, \"time\": %.6f}, ", counters->probed ? "true" : "false", counters->failed_literals,
+            counters->implied_literals, counters->substituted, counters->probe_seconds);
+    fprintf(out, "\"threads\": %d, ", counters->threads);
+    fprintf(out, "\"sharing\": {\"enabled\": %s, \"exported\": %lld, \"imported\": %lld, \"used\": %lld, "
+            "\"dropped\": %lld}, ", counters->shared ? "true" : "false", counters->exported, counters->imported,
+            counters->used, counters->dropped);
+    fprintf(out, "\"cubes\": {\"count\": %d, \"refuted_branches\": %d, \"stolen\": %d, \"lookahead_time\": %.6f}}\n",
+            counters->cubes, counters->refuted_branches, counters->cubes_stolen, counters->lookahead_seconds);
+}
+
+// Statistics of the search that produced assignment. result is "SAT",
+// "UNSAT" or "UNKNOWN"; verified tells whether the model was checked
+// against the formula; counters holds the work of the other phases.
+void print_stats(FILE* out, int format, const char* result, bool verified, Formula* formula,
+                 Assignment* assignment, const PhaseTimes* times, const PhaseCounters* counters) {
+    if (format == STATS_JSON) {
+        print_json(out, result, verified, formula, assignment, times, counters);
+    } else if (format == STATS_TEXT) {
+        print_text(out, result, verified, formula, assignment, times, counters);
+    }
+}
@@ -1,5 +1,8 @@
 #include "sat.h"
+#include <bzlib.h>
+#include <lzma.h>
 #include <time.h>
+#include <zlib.h>
 
 // Generate a random satisfiable formula
 Formula* generate_random_formula(int num_vars, int num_clauses, int clause_size) {
@@ -13,8 +16,8 @@ Formula* generate_random_formula(int num_vars, int num_clauses, int clause_size)
         exit(EXIT_FAILURE);
     }
     
-    // Generate a random assignment
-    srand(time(NULL));
+    // Generate a random assignment, the same one on every run
+    srand(BENCH_SEED);
     for (int i = 0; i < num_vars; i++) {
         solution[i] = (rand() % 2 == 0);
     }
@@ -151,6 +154,550 @@ bool run_benchmark_test(const char* filename) {
     return true;
 }
 
+// true if lit occurs in the core of the last call
+static bool core_contains(SatSolver* solver, Literal lit) {
+    int size;
+    const Literal* core = solver_core(solver, &size);
+    for (int i = 0; i < size; i++) {
+        if (core[i] == lit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A chain of queries on one incremental solver: assumptions, failed
+// assumption cores, clauses added between calls and new variables
+bool run_incremental_test() {
+    printf("\n=== Incremental Test ===\n");
+    SatSolver* solver = create_solver();
+    bool ok = true;
+
+    Literal c1[] = {1, 2};
+    Literal c2[] = {-1, 3};
+    solver_add_clause(solver, c1, 2);
+    solver_add_clause(solver, c2, 2);
+    if (!solver_solve(solver, NULL, 0) || !is_satisfied(solver->formula, solver->assignment)) {
+        printf("Error: (1 2)(-1 3) should be satisfiable\n");
+        ok = false;
+    }
+
+    // -2 forces 1 and then 3, so -2 and -3 fail together and -4 is not involved
+    Literal a1[] = {-4, -2, -3};
+    int size;
+    if (solver_solve(solver, a1, 3)) {
+        printf("Error: assumptions -2 -3 should fail\n");
+        ok = false;
+    } else {
+        solver_core(solver, &size);
+        if (size != 2 || !core_contains(solver, -2) || !core_contains(solver, -3)) {
+            printf("Error: the core should be {-2, -3}, got %d literals\n", size);
+            ok = false;
+        }
+    }
+
+    Literal c3[] = {-3};
+    solver_add_clause(solver, c3, 1);
+    if (!solver_solve(solver, NULL, 0) || solver_value(solver, 2) != LITERAL_TRUE
+        || solver_value(solver, 1) != LITERAL_FALSE) {
+        printf("Error: with -3 the only models have 1 false and 2 true\n");
+        ok = false;
+    }
+    Literal a2[] = {5, -2};
+    if (solver_solve(solver, a2, 2) || !core_contains(solver, -2) || core_contains(solver, 5)) {
+        printf("Error: assumption -2 should now fail on its own\n");
+        ok = false;
+    }
+
+    Literal c4[] = {-2, 6};
+    Literal c5[] = {-2, -6};
+    solver_add_clause(solver, c4, 2);
+    solver_add_clause(solver, c5, 2);
+    if (solver_solve(solver, NULL, 0)) {
+        printf("Error: formula should now be unsatisfiable\n");
+        ok = false;
+    } else {
+        solver_core(solver, &size);
+        if (size != 0) {
+            printf("Error: an unsatisfiable formula has an empty core\n");
+            ok = false;
+        }
+    }
+    free_solver(solver);
+
+    // every query on a benchmark formula keeps what the previous ones learned
+    Formula* formula = parse_cnf_file("examples/3sat.cnf");
+    if (!formula) {
+        fprintf(stderr, "Failed to parse the benchmark file: examples/3sat.cnf\n");
+        return false;
+    }
+    solver = create_solver_for(formula);
+    for (int var = 1; var <= formula->num_variables && ok; var++) {
+        Literal assumption = (var % 2) ? var : -var;
+        if (solver_solve(solver, &assumption, 1)) {
+            ok = is_satisfied(formula, solver->assignment) && solver_value(solver, assumption) == LITERAL_TRUE;
+        } else {
+            solver_core(solver, &size);
+            ok = size == 1;
+        }
+        if (!ok) {
+            printf("Error: query assuming %d gave a wrong answer\n", assumption);
+        }
+    }
+    printf("%d queries, %lld conflicts in total\n", formula->num_variables, solver->assignment->conflicts);
+    free_solver(solver);
+
+    if (ok) {
+        printf("Incremental queries answered correctly.\n");
+    }
+    return ok;
+}
+
+// Portfolio and cube and conquer, with and without clause sharing, must
+// agree with the serial search, and their models must satisfy the formula
+bool run_parallel_test() {
+    printf("\n=== Parallel Test ===\n");
+    const char* names[] = {"portfolio", "portfolio --no-share", "cubes", "cubes --no-share"};
+    int threads[] = {4, 4, 2, 3};
+    int depths[] = {0, 0, 4, 3};
+    bool shares[] = {true, false, true, false};
+    const char* files[] = {"examples/unsat_100-430/uuf100-01.cnf", "examples/pigeonhole_complicated.cnf"};
+    bool ok = true;
+    for (int i = 0; i < 4 && ok; i++) {
+        Formula* formula = i < 2 ? generate_random_formula(100 + 50 * i, 400 + 200 * i, 3) : parse_cnf_file(files[i - 2]);
+        if (!formula) {
+            fprintf(stderr, "Failed to parse the benchmark file: %s\n", files[i - 2]);
+            return false;
+        }
+        Assignment* assignment = create_assignment(formula->num_variables);
+        bool expected = solve(formula, assignment);
+        free_assignment(assignment);
+        for (int mode = 0; mode < 4 && ok; mode++) {
+            SolverOptions options = default_solver_options();
+            options.threads = threads[mode];
+            options.cube_depth = depths[mode];
+            options.share = shares[mode];
+            bool result;
+            assignment = depths[mode] > 0 ? solve_cubes(formula, &options, &result, NULL)
+                                          : solve_portfolio(formula, &options, &result, NULL);
+            ok = result == expected && (!result || is_satisfied(formula, assignment));
+            printf("%s: %s %s\n", i < 2 ? "random formula" : files[i - 2], names[mode],
+                   ok ? (result ? "SAT, model verified" : "UNSAT") : "Error: disagrees with the serial search");
+            free_assignment(assignment);
+        }
+        free_formula(formula);
+    }
+    return ok;
+}
+
+// Models found after preprocessing, once extended to the eliminated
+// variables, must satisfy an untouched copy of the original clauses
+bool run_reconstruction_test() {
+    printf("\n=== Model Reconstruction Test ===\n");
+    int vars_array[] = {30, 60, 50, 80, 100, 40};
+    int clauses_array[] = {45, 120, 150, 280, 400, 300};
+    int sizes_array[] = {2, 2, 3, 3, 3, 4};
+    bool ok = true;
+    for (int i = 0; i < 6 && ok; i++) {
+        Formula* formula = generate_random_formula(vars_array[i], clauses_array[i], sizes_array[i]);
+        Formula* original = copy_formula(formula);
+        ReconstructionStack eliminated = {NULL, 0, 0};
+        formula = preprocess_formula(formula, &eliminated, true, NULL);
+        Assignment* assignment = create_assignment(formula->num_variables);
+        ok = solve(formula, assignment);
+        if (ok) {
+            extend_model(&eliminated, assignment);
+            ok = is_satisfied(original, assignment);
+        }
+        printf("%d variables, %d clauses of size %d: %d clauses kept, %s\n", vars_array[i], clauses_array[i],
+               sizes_array[i], formula->size, ok ? "extended model satisfies the original" : "Error: wrong model");
+        free_reconstruction(&eliminated);
+        free_assignment(assignment);
+        free_formula(formula);
+        free_formula(original);
+    }
+    return ok;
+}
+
+// Literal of var in the planted chains, the second one alternates signs
+static Literal chain_literal(int var) {
+    return var > 10 && var % 2 == 0 ? -var : var;
+}
+
+static void add_test_clause(Formula* formula, const Literal* literals, int size) {
+    Lit lits[3];
+    for (int i = 0; i < size; i++) {
+        lits[i] = dimacs_to_lit(literals[i]);
+    }
+    add_original_clause(formula, lits, size);
+}
+
+// Two planted chains of equivalent literals, 1 <-> 2 <-> ... <-> 10 and
+// 11 <-> -12 <-> 13 <-> ... <-> -16, and a failed literal, 30, which implies
+// both 31 and -31, tied together by a few longer clauses
+static Formula* planted_probe_formula() {
+    Formula* formula = create_formula();
+    for (int var = 1; var < 16; var++) {
+        if (var == 10) {
+            continue;
+        }
+        Literal a = chain_literal(var), b = chain_literal(var + 1);
+        Literal forward[2] = {-a, b}, backward[2] = {a, -b};
+        add_test_clause(formula, forward, 2);
+        add_test_clause(formula, backward, 2);
+    }
+    Literal failed[][2] = {{-30, 31}, {-30, -31}};
+    Literal mixed[][3] = {{-1, 12, 20}, {1, -13, 21}, {2, 14, -22}, {-3, -15, 22},
+                          {30, 5, -20}, {-20, -21, 31}, {10, 16, 32}, {-32, -11, 21}};
+    for (int i = 0; i < 2; i++) {
+        add_test_clause(formula, failed[i], 2);
+    }
+    for (int i = 0; i < 8; i++) {
+        add_test_clause(formula, mixed[i], 3);
+    }
+    return formula;
+}
+
+// Distinct variables among first..last left in the clauses of formula
+static int variables_left(Formula* formula, int first, int last) {
+    bool seen[40] = {false};
+    int count = 0;
+    for (int i = 0; i < formula->size; i++) {
+        StoredClause* clause = clause_at(formula, formula->clauses[i]);
+        for (int j = 0; j < (int)clause->size; j++) {
+            int var = lit_var(clause->literals[j]) + 1;
+            if (var >= first && var <= last && !seen[var]) {
+                seen[var] = true;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Probing must fix the failed literal at level 0 and substitute each planted
+// chain by one representative, and the model of the probed formula, once
+// extended, must satisfy the original, with and without preprocessing
+bool run_probe_test() {
+    printf("\n=== Probing Test ===\n");
+    Formula* formula = planted_probe_formula();
+    ReconstructionStack stack = {NULL, 0, 0};
+    Assignment* roots = create_assignment(formula->num_variables);
+    int substituted;
+    bool ok = probe_formula(formula, roots, &stack, &substituted)
+        && roots->current_depth_level == 0
+        && literal_value(roots, dimacs_to_lit(-30)) == LITERAL_TRUE
+        && roots->vars[29].level == 0
+        && variables_left(formula, 1, 10) == 1
+        && variables_left(formula, 11, 16) == 1;
+    printf("failed literal fixed at level 0, %d literals substituted: %s\n", substituted,
+           ok ? "chains replaced by one representative each" : "Error: probing missed the planted literals");
+    free_assignment(roots);
+    free_reconstruction(&stack);
+    free_formula(formula);
+
+    for (int preprocess = 0; preprocess <= 1 && ok; preprocess++) {
+        formula = planted_probe_formula();
+        Formula* original = copy_formula(formula);
+        PhaseCounters counters;
+        memset(&counters, 0, sizeof(counters));
+        if (preprocess) {
+            formula = preprocess_formula(formula, &stack, true, &counters);
+        } else {
+            probe_search_formula(formula, &stack, &counters);
+        }
+        Assignment* assignment = create_assignment(formula->num_variables);
+        ok = counters.failed_literals >= 1 && counters.substituted == substituted && solve(formula, assignment);
+        if (ok) {
+            extend_model(&stack, assignment);
+            ok = is_satisfied(original, assignment) && literal_value(assignment, dimacs_to_lit(-30)) == LITERAL_TRUE;
+        }
+        printf("%s: %s\n", preprocess ? "preprocessed" : "probed only",
+               ok ? "extended model satisfies the original" : "Error: wrong model");
+        free_reconstruction(&stack);
+        free_assignment(assignment);
+        free_formula(formula);
+        free_formula(original);
+    }
+    return ok;
+}
+
+// Same variables and the same clauses in the same order
+static bool same_formula(Formula* a, Formula* b) {
+    if (!a || !b || a->num_variables != b->num_variables || a->size != b->size) {
+        return false;
+    }
+    for (int i = 0; i < a->size; i++) {
+        StoredClause* x = clause_at(a, a->clauses[i]);
+        StoredClause* y = clause_at(b, b->clauses[i]);
+        if (x->size != y->size || memcmp(x->literals, y->literals, x->size * sizeof(Lit)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Formula* parse_in_chunks(const char* text, size_t size, const size_t* cuts, int num_cuts) {
+    DimacsParser parser;
+    dimacs_init(&parser);
+    size_t start = 0;
+    for (int i = 0; i <= num_cuts; i++) {
+        size_t end = i < num_cuts ? cuts[i] : size;
+        dimacs_feed(&parser, text + start, end - start);
+        start = end;
+    }
+    return dimacs_finish(&parser);
+}
+
+// The chunked parser must read the same clauses wherever the input is cut,
+// inside the problem line, a comment, a number or between the digits of a
+// negative literal, and whether or not the input ends with a newline (or
+// even with the 0 of its last clause)
+bool run_parser_test() {
+    printf("\n=== Parser Test ===\n");
+    const char* texts[] = {
+        "c a comment\np cnf 12 4\n1 -2 3 0\n-10 11\n  -12 0 4 5 0\n-1 -11 12 0\n",
+        "c a comment\np cnf 12 4\n1 -2 3 0\n-10 11\n  -12 0 4 5 0\n-1 -11 12 0",
+        "c a comment\np cnf 12 4\n1 -2 3 0\n-10 11\n  -12 0 4 5 0\n-1 -11 12",
+    };
+    const char* names[] = {"with a final newline", "without a final newline", "without the last 0"};
+    const char* reference = texts[0];
+    Formula* expected = parse_cnf_buffer(reference, strlen(reference));
+    bool ok = expected && expected->num_variables == 12 && expected->size == 4;
+    for (int t = 0; t < 3 && ok; t++) {
+        const char* text = texts[t];
+        size_t size = strlen(text);
+        // every cut into two chunks, then chunks of 1 to 7 bytes
+        for (size_t cut = 0; cut <= size && ok; cut++) {
+            Formula* formula = parse_in_chunks(text, size, &cut, 1);
+            ok = same_formula(formula, expected);
+            free_formula(formula);
+        }
+        for (size_t step = 1; step < 8 && ok; step++) {
+            size_t cuts[128];
+            int num_cuts = 0;
+            for (size_t cut = step; cut < size; cut += step) {
+                cuts[num_cuts++] = cut;
+            }
+            Formula* formula = parse_in_chunks(text, size, cuts, num_cuts);
+            ok = same_formula(formula, expected);
+            free_formula(formula);
+        }
+        // the stream parser, as used for pipes and compressed files
+        FILE* file = tmpfile();
+        if (ok && file) {
+            fwrite(text, 1, size, file);
+            rewind(file);
+            Formula* formula = parse_cnf_dimacs(file);
+            ok = same_formula(formula, expected);
+            free_formula(formula);
+        }
+        if (file) {
+            fclose(file);
+        }
+        printf("%s: %s\n", names[t], ok ? "same clauses at every chunk boundary" : "Error: clauses differ");
+    }
+    free_formula(expected);
+    return ok;
+}
+
+// Write size bytes of data to path in the given compression, as the
+// command line tools would
+static bool write_compressed(const char* path, int compression, const char* data, size_t size) {
+    if (compression == COMPRESSION_GZIP) {
+        gzFile gz = gzopen(path, "wb");
+        if (!gz) {
+            return false;
+        }
+        bool ok = gzwrite(gz, data, (unsigned)size) == (int)size;
+        return gzclose(gz) == Z_OK && ok;
+    }
+    size_t capacity = size + size / 2 + 1024;
+    char* out = (char*)allocate_memory(capacity, "compressed test data");
+    size_t out_size = 0;
+    bool ok;
+    if (compression == COMPRESSION_XZ) {
+        ok = lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, NULL, (const uint8_t*)data, size,
+                                     (uint8_t*)out, &out_size, capacity) == LZMA_OK;
+    } else {
+        unsigned int length = (unsigned int)capacity;
+        ok = BZ2_bzBuffToBuffCompress(out, &length, (char*)data, (unsigned int)size, 9, 0, 0) == BZ_OK;
+        out_size = length;
+    }
+    FILE* file = ok ? fopen(path, "wb") : NULL;
+    ok = file && fwrite(out, 1, out_size, file) == out_size;
+    if (file) {
+        ok = fclose(file) == 0 && ok;
+    }
+    free(out);
+    return ok;
+}
+
+typedef struct {
+    int members;
+    int matching; //members equal to the extracted copy in the examples
+} TarCount;
+
+static void count_tar_member(const char* name, Formula* formula, void* context) {
+    TarCount* count = (TarCount*)context;
+    char path[256];
+    snprintf(path, sizeof(path), "examples/CBS_k3_n100_m449_b90/%s", name);
+    Formula* extracted = parse_cnf_file(path);
+    count->members++;
+    count->matching += same_formula(formula, extracted);
+    free_formula(extracted);
+    free_formula(formula);
+}
+
+// An example compressed with gzip, xz and bzip2 must parse to the same
+// clauses as the plain file, and every member of the example archive must
+// be handed over, equal to its extracted copy
+bool run_input_test() {
+    printf("\n=== Input Test ===\n");
+    const char* filename = "examples/sat_100-430/uf100-01.cnf";
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open the benchmark file: %s\n", filename);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    rewind(file);
+    char* data = (char*)allocate_memory(size, "test input");
+    bool ok = fread(data, 1, size, file) == size;
+    fclose(file);
+    Formula* expected = parse_cnf_file(filename);
+    ok = ok && expected;
+
+    int compressions[] = {COMPRESSION_GZIP, COMPRESSION_XZ, COMPRESSION_BZIP2};
+    const char* paths[] = {"bin/test_input.cnf.gz", "bin/test_input.cnf.xz", "bin/test_input.cnf.bz2"};
+    for (int i = 0; i < 3 && ok; i++) {
+        ok = write_compressed(paths[i], compressions[i], data, size);
+        Formula* formula = ok ? parse_cnf_file(paths[i]) : NULL;
+        ok = ok && same_formula(formula, expected);
+        printf("%s: %s\n", paths[i], ok ? "same clauses as the plain file" : "Error: clauses differ");
+        free_formula(formula);
+        remove(paths[i]);
+    }
+    free(data);
+    free_formula(expected);
+
+    const char* archive = "examples/CBS_k3_n100_m449_b90.tar.gz";
+    TarCount count = {0, 0};
+    int members = ok ? parse_cnf_tar(archive, count_tar_member, &count) : -1;
+    ok = ok && members == 1000 && count.members == 1000 && count.matching == 1000;
+    printf("%s: %d members, %d equal to their extracted copy\n", archive, members, count.matching);
+    return ok;
+}
+
+// Local search on its own must find a model of satisfiable formulas
+bool run_local_search_test() {
+    printf("\n=== Local Search Test ===\n");
+    const char* files[] = {"examples/simple.cnf", "examples/sat_100-430/uf100-01.cnf"};
+    bool ok = true;
+    for (int i = 0; i < 2 && ok; i++) {
+        Formula* formula = parse_cnf_file(files[i]);
+        if (!formula) {
+            fprintf(stderr, "Failed to parse the benchmark file: %s\n", files[i]);
+            return false;
+        }
+        Assignment* assignment = create_assignment(formula->num_variables);
+        assignment->options.sls = SLS_ONLY;
+        ok = solve(formula, assignment) && is_satisfied(formula, assignment);
+        printf("%s: %s after %lld flips\n", files[i], ok ? "model found" : "Error: no model", assignment->sls_flips);
+        free_assignment(assignment);
+        free_formula(formula);
+    }
+    return ok;
+}
+
+// Proofs of unsatisfiable formulas, preprocessed and searched, must pass
+// the checker in both formats, and a proof of a clause that does not follow
+// must fail it
+bool run_proof_test() {
+    printf("\n=== Proof Test ===\n");
+    const char* files[] = {"examples/pigeonhole_complicated.cnf", "examples/unsat_100-430/uuf100-01.cnf"};
+    const char* proof_file = "bin/test_proof.drat";
+    bool ok = true;
+    for (int i = 0; i < 4 && ok; i++) {
+        const char* filename = files[i % 2];
+        bool binary = i < 2;
+        Formula* formula = parse_cnf_file(filename);
+        if (!formula) {
+            fprintf(stderr, "Failed to parse the benchmark file: %s\n", filename);
+            return false;
+        }
+        Proof* proof = open_proof(proof_file, binary);
+        if (!proof) {
+            free_formula(formula);
+            return false;
+        }
+        formula->proof = proof;
+        ReconstructionStack eliminated = {NULL, 0, 0};
+        formula = preprocess_formula(formula, &eliminated, true, NULL);
+        Assignment* assignment = create_assignment(formula->num_variables);
+        bool result = solve(formula, assignment);
+        if (!result) {
+            proof_add(proof, NULL, 0);
+        }
+        ok = !result && close_proof(proof);
+        free_reconstruction(&eliminated);
+        free_assignment(assignment);
+        free_formula(formula);
+
+        formula = parse_cnf_file(filename);
+        ok = ok && check_proof(formula, proof_file);
+        printf("%s: %s proof %s\n", filename, binary ? "binary" : "text", ok ? "verified" : "Error: not verified");
+        free_formula(formula);
+    }
+
+    FILE* file = fopen(proof_file, "w");
+    if (!file) {
+        perror("Failed to open the proof file");
+        return false;
+    }
+    fprintf(file, "1 2 0\n0\n");
+    fclose(file);
+    Formula* formula = parse_cnf_file(files[1]);
+    if (check_proof(formula, proof_file)) {
+        printf("Error: a proof of a clause that does not follow was verified\n");
+        ok = false;
+    }
+    free_formula(formula);
+
+    // a lemma repeating one literal many times must not overrun the
+    // checker's buffers, sized by the number of variables
+    const char* cnf_file = "bin/test_proof.cnf";
+    file = fopen(cnf_file, "w");
+    if (!file) {
+        perror("Failed to open the CNF file");
+        return false;
+    }
+    fprintf(file, "p cnf 2 2\n-1 2 0\n-2 -1 0\n");
+    fclose(file);
+    file = fopen(proof_file, "w");
+    if (!file) {
+        perror("Failed to open the proof file");
+        return false;
+    }
+    for (int i = 0; i < 200; i++) {
+        fprintf(file, "1 ");
+    }
+    fprintf(file, "0\n0\n");
+    fclose(file);
+    formula = parse_cnf_file(cnf_file);
+    if (!formula || check_proof(formula, proof_file)) {
+        printf("Error: a lemma of repeated literals that does not follow was verified\n");
+        ok = false;
+    }
+    if (formula) {
+        free_formula(formula);
+    }
+    remove(cnf_file);
+    remove(proof_file);
+    return ok;
+}
+
 int run_all_tests() {
     int tests_failed = 0;
     
@@ -184,6 +731,46 @@ int run_all_tests() {
     if (!run_performance_test()) {
         tests_failed++;
     }
+
+    // Test 6: Incremental solving with assumptions
+    if (!run_incremental_test()) {
+        tests_failed++;
+    }
+
+    // Test 7: Local search on its own
+    if (!run_local_search_test()) {
+        tests_failed++;
+    }
+
+    // Test 8: Portfolio and cube and conquer against the serial search
+    if (!run_parallel_test()) {
+        tests_failed++;
+    }
+
+    // Test 9: Model reconstruction after preprocessing
+    if (!run_reconstruction_test()) {
+        tests_failed++;
+    }
+
+    // Test 10: DRAT proofs of unsatisfiability
+    if (!run_proof_test()) {
+        tests_failed++;
+    }
+
+    // Test 11: Failed literals and equivalent literals before the search
+    if (!run_probe_test()) {
+        tests_failed++;
+    }
+
+    // Test 12: DIMACS input cut into arbitrary chunks
+    if (!run_parser_test()) {
+        tests_failed++;
+    }
+
+    // Test 13: Compressed files and tar archives
+    if (!run_input_test()) {
+        tests_failed++;
+    }
     
     // Summary
     printf("\n=== Test Summary ===\n");